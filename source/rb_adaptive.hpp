@@ -0,0 +1,245 @@
+#pragma once
+
+#include "rb_tree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace rb {
+
+// Множество, которое до N ключей хранит их во встроенном отсортированном
+// массиве без выделений памяти, а при переполнении переносит в rb::Tree.
+// Если после удалений в дереве остаётся N / 2 ключей, множество снова
+// становится встроенным. Поиск и ранг во встроенном режиме для
+// арифметических ключей со стандартным компаратором считают число меньших
+// элементов простым циклом без ветвлений, который компилятор векторизует.
+template <typename T, std::size_t N = 64, typename Compare = KeyLess<T>>
+class AdaptiveSet {
+    static_assert(N > 1, "встроенный массив должен вмещать хотя бы два ключа");
+    static_assert(std::is_default_constructible_v<T>,
+                  "встроенный массив создаёт N ключей заранее");
+
+    using tree_type = Tree<T, NoAugment, IdentityKey, Compare>;
+
+public:
+    using value_type = T;
+    using key_type = T;
+    using key_compare = Compare;
+
+    static constexpr std::size_t inline_capacity = N;
+
+    AdaptiveSet() = default;
+
+    explicit AdaptiveSet(const Compare& compare) : compare_(compare) {}
+
+    std::size_t size() const {
+        return in_tree() ? tree().size() : keys().count;
+    }
+    bool empty() const { return size() == 0; }
+
+    // true, пока ключи лежат во встроенном массиве.
+    bool is_inline() const { return !in_tree(); }
+
+    // Вставляет значение; false при дубликате.
+    template <typename U>
+    bool insert(U&& value) {
+        if (in_tree()) {
+            return tree().insert(std::forward<U>(value));
+        }
+        Inline& inline_keys = keys();
+        const std::size_t index = inline_rank(value);
+        if (index < inline_keys.count &&
+            !compare_(value, inline_keys.items[index])) {
+            return false;
+        }
+        if (inline_keys.count == N) {
+            move_to_tree();
+            return tree().insert(std::forward<U>(value));
+        }
+        const auto first = inline_keys.items.begin();
+        std::move_backward(
+            first + static_cast<std::ptrdiff_t>(index),
+            first + static_cast<std::ptrdiff_t>(inline_keys.count),
+            first + static_cast<std::ptrdiff_t>(inline_keys.count + 1));
+        inline_keys.items[index] = T(std::forward<U>(value));
+        ++inline_keys.count;
+        return true;
+    }
+
+    // Удаляет значение; false, если его нет.
+    bool erase(const key_type& value) {
+        return erase<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    bool erase(const K& value) {
+        if (in_tree()) {
+            if (!tree().erase(value)) {
+                return false;
+            }
+            if (tree().size() <= N / 2) {
+                move_to_inline();
+            }
+            return true;
+        }
+        Inline& inline_keys = keys();
+        const std::size_t index = inline_rank(value);
+        if (index == inline_keys.count ||
+            compare_(value, inline_keys.items[index])) {
+            return false;
+        }
+        const auto first = inline_keys.items.begin();
+        std::move(first + static_cast<std::ptrdiff_t>(index + 1),
+                  first + static_cast<std::ptrdiff_t>(inline_keys.count),
+                  first + static_cast<std::ptrdiff_t>(index));
+        --inline_keys.count;
+        inline_keys.items[inline_keys.count] = T{};
+        return true;
+    }
+
+    bool contains(const key_type& value) const {
+        return contains<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    bool contains(const K& value) const {
+        if (in_tree()) {
+            return tree().contains(value);
+        }
+        const std::size_t index = inline_rank(value);
+        return index < keys().count && !compare_(value, keys().items[index]);
+    }
+
+    // Количество ключей, строго меньших заданного.
+    std::size_t rank(const key_type& value) const {
+        return rank<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    std::size_t rank(const K& value) const {
+        return in_tree() ? tree().rank(value) : inline_rank(value);
+    }
+
+    // Количество ключей в отрезке [first, second].
+    std::size_t distance(const key_type& first, const key_type& second) const {
+        return distance<key_type>(first, second);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    std::size_t distance(const K& first, const K& second) const {
+        if (in_tree()) {
+            return tree().distance(first, second);
+        }
+        if (compare_(second, first)) {
+            return 0;
+        }
+        std::size_t high = inline_rank(second);
+        if (high < keys().count && !compare_(second, keys().items[high])) {
+            ++high;
+        }
+        return high - inline_rank(first);
+    }
+
+    // k-й по возрастанию ключ (с нуля) или nullptr.
+    const T* select(std::size_t k) const {
+        if (in_tree()) {
+            const auto it = tree().select(k);
+            return it == tree().end() ? nullptr : &*it;
+        }
+        return k < keys().count ? &keys().items[k] : nullptr;
+    }
+
+    // Наименьший ключ, не меньший заданного, или nullptr.
+    const T* lower_bound(const key_type& value) const {
+        return lower_bound<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    const T* lower_bound(const K& value) const {
+        if (in_tree()) {
+            const auto it = tree().lower_bound(value);
+            return it == tree().end() ? nullptr : &*it;
+        }
+        const std::size_t index = inline_rank(value);
+        return index < keys().count ? &keys().items[index] : nullptr;
+    }
+
+    bool is_valid() const {
+        if (in_tree()) {
+            return tree().size() > N / 2 && tree().is_valid();
+        }
+        for (std::size_t i = 1; i < keys().count; ++i) {
+            if (!compare_(keys().items[i - 1], keys().items[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Inline {
+        std::array<T, N> items{};
+        std::size_t count = 0;
+    };
+
+    static constexpr bool counts_by_scan =
+        std::is_arithmetic_v<T> && (std::is_same_v<Compare, ThreeWayLess> ||
+                                    std::is_same_v<Compare, KeyLess<T>>);
+
+    // Позиция первого элемента, не меньшего value, во встроенном массиве.
+    template <typename K>
+    std::size_t inline_rank(const K& value) const {
+        const Inline& inline_keys = keys();
+        if constexpr (counts_by_scan && std::is_arithmetic_v<K>) {
+            // Массив отсортирован, поэтому позиция равна числу меньших
+            // элементов; подсчёт без ветвлений компилятор векторизует.
+            // value_less сравнивает знаковые и беззнаковые по значению,
+            // как и сам компаратор.
+            std::size_t result = 0;
+            for (std::size_t i = 0; i < inline_keys.count; ++i) {
+                result += static_cast<std::size_t>(
+                    detail::value_less(inline_keys.items[i], value));
+            }
+            return result;
+        } else {
+            const auto first = inline_keys.items.begin();
+            const auto last =
+                first + static_cast<std::ptrdiff_t>(inline_keys.count);
+            return static_cast<std::size_t>(
+                std::lower_bound(first, last, value, compare_) - first);
+        }
+    }
+
+    void move_to_tree() {
+        Inline inline_keys = std::move(keys());
+        tree_type& target = storage_.template emplace<tree_type>(compare_);
+        for (std::size_t i = 0; i < inline_keys.count; ++i) {
+            target.insert(std::move(inline_keys.items[i]));
+        }
+    }
+
+    void move_to_inline() {
+        Inline inline_keys;
+        for (const T& value : tree()) {
+            inline_keys.items[inline_keys.count++] = value;
+        }
+        storage_.template emplace<Inline>(std::move(inline_keys));
+    }
+
+    bool in_tree() const { return storage_.index() == 1; }
+    Inline& keys() { return std::get<Inline>(storage_); }
+    const Inline& keys() const { return std::get<Inline>(storage_); }
+    tree_type& tree() { return std::get<tree_type>(storage_); }
+    const tree_type& tree() const { return std::get<tree_type>(storage_); }
+
+    Compare compare_;
+    // Встроенный массив и дерево не живут одновременно: объект занимает
+    // место только под большее из двух представлений.
+    std::variant<Inline, tree_type> storage_;
+};
+
+} // namespace rb
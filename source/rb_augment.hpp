@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace rb {
+
+// Политика аугментации описывает ассоциативную сводку по поддереву:
+//   summary_type            — тип сводки;
+//   identity()              — нейтральный элемент;
+//   lift(value)             — сводка одного значения;
+//   combine(lhs, rhs)       — объединение сводок соседних отрезков (lhs левее).
+// Дерево пересчитывает сводку узла при каждом изменении его детей.
+
+// Отсутствие аугментации: узлы хранят только размер поддерева.
+struct NoAugment {
+    using summary_type = void;
+};
+
+// Сумма значений поддерева.
+template <typename T>
+struct SumAugment {
+    using summary_type = T;
+
+    static summary_type identity() { return summary_type{}; }
+    static summary_type lift(const T& value) { return value; }
+    static summary_type combine(const summary_type& lhs,
+                                const summary_type& rhs) {
+        return lhs + rhs;
+    }
+};
+
+// Минимум значений поддерева.
+template <typename T>
+struct MinAugment {
+    using summary_type = T;
+
+    static summary_type identity() { return std::numeric_limits<T>::max(); }
+    static summary_type lift(const T& value) { return value; }
+    static summary_type combine(const summary_type& lhs,
+                                const summary_type& rhs) {
+        return rhs < lhs ? rhs : lhs;
+    }
+};
+
+// Максимум значений поддерева.
+template <typename T>
+struct MaxAugment {
+    using summary_type = T;
+
+    static summary_type identity() { return std::numeric_limits<T>::lowest(); }
+    static summary_type lift(const T& value) { return value; }
+    static summary_type combine(const summary_type& lhs,
+                                const summary_type& rhs) {
+        return lhs < rhs ? rhs : lhs;
+    }
+};
+
+// Количество значений поддерева.
+template <typename T>
+struct CountAugment {
+    using summary_type = std::size_t;
+
+    static summary_type identity() { return 0; }
+    static summary_type lift(const T&) { return 1; }
+    static summary_type combine(summary_type lhs, summary_type rhs) {
+        return lhs + rhs;
+    }
+};
+
+template <typename Augment>
+inline constexpr bool has_augment_v = !std::is_same_v<Augment, NoAugment>;
+
+// Хранилище сводки внутри узла; для NoAugment не занимает места.
+template <typename Augment>
+class NodeSummary {
+public:
+    using summary_type = typename Augment::summary_type;
+
+    const summary_type& summary() const { return summary_; }
+    void set_summary(summary_type summary) { summary_ = std::move(summary); }
+
+private:
+    summary_type summary_{};
+};
+
+template <>
+class NodeSummary<NoAugment> {};
+
+} // namespace rb
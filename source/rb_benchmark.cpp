@@ -1,10 +1,19 @@
 #include "rb_tree.hpp"
+#include "rb_adaptive.hpp"
+#include "rb_bitvector.hpp"
+#include "rb_fenwick.hpp"
+#include "rb_index_storage.hpp"
+#include "rb_path_tree.hpp"
+#include "rb_roaring.hpp"
+#include "rb_yfast.hpp"
 
 #include <algorithm>
 #include <chrono>
 #include <cstddef>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <memory_resource>
 #include <random>
 #include <set>
 #include <string>
@@ -15,7 +24,7 @@
 namespace {
 
 struct Operation {
-    char type; // 'k' or 'q'
+    char type; // 'k', 'q', 'd', 's' или 'r'
     int a = 0;
     int b = 0;
 };
@@ -25,6 +34,10 @@ struct Options {
     unsigned seed = 42;
     int max_value = 1000000;
     double insert_ratio = 0.5;
+    // Доли удалений, select и rank в смешанной нагрузке.
+    double erase_ratio = 0.1;
+    double select_ratio = 0.1;
+    double rank_ratio = 0.1;
 };
 
 bool parse_argument(std::string_view arg,
@@ -54,6 +67,12 @@ Options parse_options(int argc, char* argv[]) {
             opts.max_value = std::stoi(value);
         } else if (parse_argument(arg, "--insert-ratio", value)) {
             opts.insert_ratio = std::clamp(std::stod(value), 0.0, 1.0);
+        } else if (parse_argument(arg, "--erase-ratio", value)) {
+            opts.erase_ratio = std::clamp(std::stod(value), 0.0, 1.0);
+        } else if (parse_argument(arg, "--select-ratio", value)) {
+            opts.select_ratio = std::clamp(std::stod(value), 0.0, 1.0);
+        } else if (parse_argument(arg, "--rank-ratio", value)) {
+            opts.rank_ratio = std::clamp(std::stod(value), 0.0, 1.0);
         } else {
             std::cerr << "Unknown argument: " << arg << '\n';
             std::exit(1);
@@ -91,13 +110,54 @@ std::vector<Operation> build_workload(const Options& opts) {
     return operations;
 }
 
+// Смешанная нагрузка: вставки, удаления, select, rank и запросы q. Индекс
+// select берётся не больше числа уже сделанных вставок. std::set тратит
+// O(n) на select и rank, поэтому операций в десять раз меньше, чем --ops.
+std::vector<Operation> build_mixed_workload(const Options& opts) {
+    const std::size_t count = std::max<std::size_t>(1, opts.operation_count / 10);
+    std::vector<Operation> operations;
+    operations.reserve(count);
+
+    std::mt19937 rng(opts.seed);
+    std::uniform_real_distribution<double> ratio_dist(0.0, 1.0);
+    std::uniform_int_distribution<int> value_dist(0, opts.max_value);
+    const double erase_edge = opts.insert_ratio + opts.erase_ratio;
+    const double select_edge = erase_edge + opts.select_ratio;
+    const double rank_edge = select_edge + opts.rank_ratio;
+    int inserted = 0;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const double choice = ratio_dist(rng);
+        if (choice < opts.insert_ratio) {
+            operations.push_back(Operation{.type = 'k', .a = value_dist(rng)});
+            ++inserted;
+        } else if (choice < erase_edge) {
+            operations.push_back(Operation{.type = 'd', .a = value_dist(rng)});
+        } else if (choice < select_edge) {
+            std::uniform_int_distribution<int> index_dist(1, inserted + 1);
+            operations.push_back(Operation{.type = 's', .a = index_dist(rng)});
+        } else if (choice < rank_edge) {
+            operations.push_back(Operation{.type = 'r', .a = value_dist(rng)});
+        } else {
+            operations.push_back(Operation{
+                .type = 'q',
+                .a = value_dist(rng),
+                .b = value_dist(rng),
+            });
+        }
+    }
+
+    return operations;
+}
+
 struct BenchmarkResult {
     std::chrono::duration<double> elapsed{};
     std::size_t checksum = 0;
 };
 
-BenchmarkResult run_rb_tree_rank_distance(const std::vector<Operation>& ops) {
-    rb::Tree<int> tree;
+template <typename TreeType = rb::Tree<int>>
+BenchmarkResult run_rb_tree_rank_distance(const std::vector<Operation>& ops,
+                                          TreeType tree = TreeType()) {
     std::size_t checksum = 0;
 
     const auto start = std::chrono::steady_clock::now();
@@ -118,6 +178,104 @@ BenchmarkResult run_rb_tree_rank_distance(const std::vector<Operation>& ops) {
     };
 }
 
+// Ключ с номером k (с нуля) плюс один или 0, если его нет.
+std::size_t selected(const rb::Tree<int>& tree, std::size_t k) {
+    const auto it = tree.select(k);
+    return it == tree.end() ? 0 : static_cast<std::size_t>(*it) + 1;
+}
+
+template <typename BoundedSet>
+std::size_t selected(const BoundedSet& set, std::size_t k) {
+    const auto key = set.select(k);
+    return key ? static_cast<std::size_t>(*key) + 1 : 0;
+}
+
+template <typename SetType = rb::Tree<int>>
+BenchmarkResult run_mixed(const std::vector<Operation>& ops,
+                          SetType set = SetType()) {
+    std::size_t checksum = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& op : ops) {
+        if (op.type == 'k') {
+            set.insert(op.a);
+        } else if (op.type == 'd') {
+            set.erase(op.a);
+        } else if (op.type == 's') {
+            checksum += selected(set, static_cast<std::size_t>(op.a - 1));
+        } else if (op.type == 'r') {
+            checksum += set.rank(op.a);
+        } else {
+            checksum += set.distance(op.a, op.b);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = checksum,
+    };
+}
+
+// std::set: select и rank проходят итераторами за O(n).
+BenchmarkResult run_std_set_mixed(const std::vector<Operation>& ops) {
+    std::set<int> set;
+    std::size_t checksum = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& op : ops) {
+        if (op.type == 'k') {
+            set.insert(op.a);
+        } else if (op.type == 'd') {
+            set.erase(op.a);
+        } else if (op.type == 's') {
+            const auto k = static_cast<std::size_t>(op.a - 1);
+            if (k < set.size()) {
+                checksum += static_cast<std::size_t>(
+                                *std::next(set.begin(),
+                                           static_cast<std::ptrdiff_t>(k))) +
+                            1;
+            }
+        } else if (op.type == 'r') {
+            checksum += static_cast<std::size_t>(
+                std::distance(set.begin(), set.lower_bound(op.a)));
+        } else if (op.b >= op.a) {
+            checksum += static_cast<std::size_t>(
+                std::distance(set.lower_bound(op.a), set.upper_bound(op.b)));
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = checksum,
+    };
+}
+
+// Разбрасывает ту же нагрузку по множеству маленьких наборов.
+template <typename SetType>
+BenchmarkResult run_small_sets(const std::vector<Operation>& ops) {
+    constexpr std::size_t set_count = 4096;
+    std::vector<SetType> sets(set_count);
+    std::size_t checksum = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& op : ops) {
+        auto& set = sets[static_cast<std::size_t>(op.a) % set_count];
+        if (op.type == 'k') {
+            set.insert(op.a);
+        } else if (op.type == 'q') {
+            checksum += set.distance(op.a, op.b);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = checksum,
+    };
+}
+
 BenchmarkResult run_rb_tree_iter_distance(const std::vector<Operation>& ops) {
     rb::Tree<int> tree;
     std::size_t checksum = 0;
@@ -172,6 +330,152 @@ BenchmarkResult run_std_set(const std::vector<Operation>& ops) {
     };
 }
 
+// Сравнивает вставку ключей по одному с параллельной сборкой from_unsorted.
+std::vector<int> collect_keys(const std::vector<Operation>& ops) {
+    std::vector<int> keys;
+    for (const auto& op : ops) {
+        if (op.type == 'k') {
+            keys.push_back(op.a);
+        }
+    }
+    return keys;
+}
+
+// Время включает уничтожение дерева; с ресурсом узлы берутся из него.
+BenchmarkResult run_insert_loop(const std::vector<int>& keys,
+                                std::pmr::memory_resource* resource = nullptr) {
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t checksum = 0;
+    {
+        rb::Tree<int> tree(resource);
+        for (int key : keys) {
+            tree.insert(key);
+        }
+        checksum = tree.size();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = checksum,
+    };
+}
+
+BenchmarkResult run_arena_insert_loop(const std::vector<int>& keys) {
+    std::pmr::monotonic_buffer_resource arena(std::size_t{1} << 20);
+    return run_insert_loop(keys, &arena);
+}
+
+BenchmarkResult run_bulk_load(const std::vector<int>& keys) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto tree = rb::Tree<int>::from_unsorted(keys.begin(), keys.end());
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = tree.size(),
+    };
+}
+
+// Сравнивает последовательные rank с чередующимися rank_batch на дереве,
+// которое не помещается в кэш последнего уровня.
+rb::Tree<int> build_large_tree(const Options& opts) {
+    constexpr std::size_t large_tree_size = std::size_t{1} << 22;
+    std::mt19937 rng(opts.seed);
+    std::uniform_int_distribution<int> value_dist;
+    std::vector<int> keys(large_tree_size);
+    for (int& key : keys) {
+        key = value_dist(rng);
+    }
+    return rb::Tree<int>::from_unsorted(keys.begin(), keys.end());
+}
+
+std::vector<int> build_rank_queries(const Options& opts) {
+    std::mt19937 rng(opts.seed + 1);
+    std::uniform_int_distribution<int> value_dist;
+    std::vector<int> keys(opts.operation_count);
+    for (int& key : keys) {
+        key = value_dist(rng);
+    }
+    return keys;
+}
+
+BenchmarkResult run_serial_ranks(const rb::Tree<int>& tree,
+                                 const std::vector<int>& keys) {
+    std::size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int key : keys) {
+        checksum += tree.rank(key);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = checksum,
+    };
+}
+
+BenchmarkResult run_batched_ranks(const rb::Tree<int>& tree,
+                                  const std::vector<int>& keys) {
+    std::size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t rank : tree.rank_batch(keys)) {
+        checksum += rank;
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = checksum,
+    };
+}
+
+// Поток запросов, каждый из которых близок к предыдущему.
+std::vector<int> build_local_queries(const Options& opts) {
+    std::mt19937 rng(opts.seed + 2);
+    std::uniform_int_distribution<int> step(-4096, 4096);
+    std::vector<int> keys(opts.operation_count);
+    int key = std::numeric_limits<int>::max() / 2;
+    for (int& query : keys) {
+        key += step(rng);
+        query = key;
+    }
+    return keys;
+}
+
+BenchmarkResult run_root_searches(const rb::Tree<int>& tree,
+                                  const std::vector<int>& keys) {
+    std::size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int key : keys) {
+        const auto it = tree.lower_bound(key);
+        checksum += tree.rank(key) + (it == tree.end() ? 0 : 1);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = checksum,
+    };
+}
+
+BenchmarkResult run_finger_searches(const rb::Tree<int>& tree,
+                                    const std::vector<int>& keys) {
+    std::size_t checksum = 0;
+    auto finger = tree.finger();
+    const auto start = std::chrono::steady_clock::now();
+    for (int key : keys) {
+        const auto it = finger.lower_bound(key);
+        checksum += it.rank() + (it.base() == tree.end() ? 0 : 1);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        .elapsed = end - start,
+        .checksum = checksum,
+    };
+}
+
 void print_header(const Options& opts) {
     std::cout << "RB-tree vs std::set benchmark\n";
     std::cout << "Operations:    " << opts.operation_count << '\n';
@@ -198,12 +502,86 @@ int main(int argc, char* argv[]) {
 
     const auto rb_result_rank = run_rb_tree_rank_distance(workload);
     print_result("rb::Tree::distance      ", rb_result_rank);
+
+    using CompactTree = rb::Tree<int,
+                                 rb::NoAugment,
+                                 rb::IdentityKey,
+                                 rb::ThreeWayLess,
+                                 rb::CompactNodeTraits>;
+    const auto rb_result_compact =
+        run_rb_tree_rank_distance<CompactTree>(workload);
+    print_result("rb::Tree<u32>::distance ", rb_result_compact);
+
+    const auto rb_result_path =
+        run_rb_tree_rank_distance<rb::PathTree<int>>(workload);
+    print_result("rb::PathTree::distance  ", rb_result_path);
+
+    const auto rb_result_index =
+        run_rb_tree_rank_distance<rb::IndexTree<int>>(workload);
+    print_result("rb::IndexTree::distance ", rb_result_index);
+
+    const auto rb_result_soa =
+        run_rb_tree_rank_distance<rb::SoaTree<int>>(workload);
+    print_result("rb::SoaTree::distance   ", rb_result_soa);
+
+    const auto bitvector_result = run_rb_tree_rank_distance(
+        workload,
+        rb::BitvectorSet(static_cast<std::size_t>(opts.max_value) + 1));
+    print_result("rb::BitvectorSet        ", bitvector_result);
+
+    const auto fenwick_result = run_rb_tree_rank_distance(
+        workload,
+        rb::FenwickSet(static_cast<std::size_t>(opts.max_value) + 1));
+    print_result("rb::FenwickSet          ", fenwick_result);
+
+    const auto roaring_result =
+        run_rb_tree_rank_distance<rb::RoaringSet>(workload);
+    print_result("rb::RoaringSet          ", roaring_result);
+
+    const auto yfast_result = run_rb_tree_rank_distance<rb::YFastSet>(workload);
+    print_result("rb::YFastSet            ", yfast_result);
     
+    const auto small_tree_result = run_small_sets<rb::Tree<int>>(workload);
+    print_result("4096 x rb::Tree         ", small_tree_result);
+
+    const auto small_adaptive_result =
+        run_small_sets<rb::AdaptiveSet<int>>(workload);
+    print_result("4096 x rb::AdaptiveSet  ", small_adaptive_result);
+
+    const auto keys = collect_keys(workload);
+    print_result("rb::Tree insert loop    ", run_insert_loop(keys));
+    print_result("rb::Tree insert (arena) ", run_arena_insert_loop(keys));
+    print_result("rb::Tree::from_unsorted ", run_bulk_load(keys));
+
+    const auto large_tree = build_large_tree(opts);
+    const auto rank_queries = build_rank_queries(opts);
+    print_result("4M rb::Tree::rank       ",
+                 run_serial_ranks(large_tree, rank_queries));
+    print_result("4M rb::Tree::rank_batch ",
+                 run_batched_ranks(large_tree, rank_queries));
+    const auto local_queries = build_local_queries(opts);
+    print_result("4M lower_bound + rank   ",
+                 run_root_searches(large_tree, local_queries));
+    print_result("4M rb::Tree::Finger     ",
+                 run_finger_searches(large_tree, local_queries));
+
     const auto rb_result_iter = run_rb_tree_iter_distance(workload);
     print_result("rb::Tree + std::distance", rb_result_iter);
     
     const auto std_result = run_std_set(workload);
     print_result("std::set                ", std_result);
 
+    std::cout << "\nMixed k/d/s/r/q workload (erase " << opts.erase_ratio
+              << ", select " << opts.select_ratio << ", rank "
+              << opts.rank_ratio << ")\n";
+    const auto mixed = build_mixed_workload(opts);
+    const auto universe = static_cast<std::size_t>(opts.max_value) + 1;
+    print_result("rb::Tree                ", run_mixed(mixed));
+    print_result("rb::BitvectorSet        ",
+                 run_mixed(mixed, rb::BitvectorSet(universe)));
+    print_result("rb::FenwickSet          ",
+                 run_mixed(mixed, rb::FenwickSet(universe)));
+    print_result("std::set                ", run_std_set_mixed(mixed));
+
     return 0;
 }
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace rb {
+
+namespace detail {
+
+inline unsigned popcount64(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_popcountll(word));
+#else
+    unsigned count = 0;
+    for (; word != 0; word &= word - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Номер младшего установленного бита; word != 0.
+inline unsigned lowest_bit64(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+    unsigned index = 0;
+    for (; (word & 1u) == 0; word >>= 1) {
+        ++index;
+    }
+    return index;
+#endif
+}
+
+} // namespace detail
+
+// Множество целых ключей из [0, universe) в виде битового вектора с
+// двухуровневым каталогом рангов: для каждого суперблока (256 слов) хранится
+// число ключей до него, для каждого блока (8 слов) — число ключей от начала
+// его суперблока. Ранг считается за O(1): два обращения к каталогу и не
+// более восьми popcount. Вставка и удаление меняют бит и сдвигают счётчики
+// последующих блоков своего суперблока и всех последующих суперблоков —
+// O(universe / 16384 + 32) простых инкрементов без ветвлений.
+class BitvectorSet {
+public:
+    using key_type = std::uint32_t;
+
+    // Создаёт пустое множество для ключей из [0, universe).
+    explicit BitvectorSet(std::size_t universe = 0)
+        : universe_(universe),
+          words_((universe + word_bits - 1) / word_bits + 1, 0),
+          block_counts_(words_.size() / block_words + 1, 0),
+          super_counts_(words_.size() / super_words + 1, 0) {}
+
+    std::size_t universe() const { return universe_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Вставляет ключ; false при дубликате или ключе вне [0, universe).
+    bool insert(key_type key) {
+        if (key >= universe_ || contains(key)) {
+            return false;
+        }
+        words_[key / word_bits] |= bit_of(key);
+        shift_counts(key, 1);
+        ++size_;
+        return true;
+    }
+
+    // Удаляет ключ; false, если его нет.
+    bool erase(key_type key) {
+        if (key >= universe_ || !contains(key)) {
+            return false;
+        }
+        words_[key / word_bits] &= ~bit_of(key);
+        shift_counts(key, -1);
+        --size_;
+        return true;
+    }
+
+    bool contains(key_type key) const {
+        return key < universe_ && (words_[key / word_bits] & bit_of(key)) != 0;
+    }
+
+    // Количество ключей, строго меньших key. Принимает любые целые,
+    // значения вне [0, universe) прижимаются к границам.
+    template <typename K>
+    std::size_t rank(K key) const {
+        static_assert(std::is_integral_v<K>, "ключи BitvectorSet — целые");
+        if constexpr (std::is_signed_v<K>) {
+            if (key <= 0) {
+                return 0;
+            }
+        }
+        if (static_cast<std::make_unsigned_t<K>>(key) >= universe_) {
+            return size_;
+        }
+        return rank_in_range(static_cast<std::size_t>(key));
+    }
+
+    // Количество ключей в отрезке [first, second].
+    template <typename K>
+    std::size_t distance(K first, K second) const {
+        if (second < first) {
+            return 0;
+        }
+        const std::size_t high =
+            contains_any(second) ? rank(second) + 1 : rank(second);
+        return high - rank(first);
+    }
+
+    // k-й по возрастанию ключ (с нуля): двоичный поиск по суперблокам,
+    // затем проход по блокам суперблока и словам блока.
+    std::optional<key_type> select(std::size_t k) const {
+        if (k >= size_) {
+            return std::nullopt;
+        }
+        const std::size_t super = static_cast<std::size_t>(
+            std::upper_bound(super_counts_.begin(), super_counts_.end(), k) -
+            super_counts_.begin() - 1);
+        std::size_t remaining = k - super_counts_[super];
+
+        const auto first_block = block_counts_.begin() +
+                                 static_cast<std::ptrdiff_t>(super * blocks_per_super);
+        const auto last_block = block_counts_.begin() +
+                                static_cast<std::ptrdiff_t>(std::min(
+                                    (super + 1) * blocks_per_super, block_counts_.size()));
+        const std::size_t block = static_cast<std::size_t>(
+            std::upper_bound(first_block, last_block, remaining) -
+            block_counts_.begin() - 1);
+        remaining -= block_counts_[block];
+
+        std::size_t word = block * block_words;
+        for (;; ++word) {
+            const std::size_t count = detail::popcount64(words_[word]);
+            if (remaining < count) {
+                break;
+            }
+            remaining -= count;
+        }
+        std::uint64_t bits = words_[word];
+        for (; remaining > 0; --remaining) {
+            bits &= bits - 1;
+        }
+        return static_cast<key_type>(word * word_bits + detail::lowest_bit64(bits));
+    }
+
+private:
+    static constexpr std::size_t word_bits = 64;
+    static constexpr std::size_t block_words = 8;
+    static constexpr std::size_t super_words = 256;
+    static constexpr std::size_t blocks_per_super = super_words / block_words;
+
+    static std::uint64_t bit_of(std::size_t key) {
+        return std::uint64_t{1} << (key % word_bits);
+    }
+
+    template <typename K>
+    bool contains_any(K key) const {
+        if constexpr (std::is_signed_v<K>) {
+            if (key < 0) {
+                return false;
+            }
+        }
+        return static_cast<std::make_unsigned_t<K>>(key) < universe_ &&
+               contains(static_cast<key_type>(key));
+    }
+
+    std::size_t rank_in_range(std::size_t key) const {
+        const std::size_t word = key / word_bits;
+        const std::size_t block = word / block_words;
+        std::size_t result = super_counts_[word / super_words] +
+                             block_counts_[block];
+        for (std::size_t i = block * block_words; i < word; ++i) {
+            result += detail::popcount64(words_[i]);
+        }
+        return result + detail::popcount64(words_[word] & (bit_of(key) - 1));
+    }
+
+    // Сдвигает счётчики каталога, стоящие после ключа, на delta.
+    void shift_counts(std::size_t key, int delta) {
+        const std::size_t word = key / word_bits;
+        const std::size_t block = word / block_words;
+        const std::size_t super = word / super_words;
+
+        const std::size_t block_end =
+            std::min((super + 1) * blocks_per_super, block_counts_.size());
+        for (std::size_t i = block + 1; i < block_end; ++i) {
+            block_counts_[i] = static_cast<std::uint16_t>(block_counts_[i] + delta);
+        }
+        for (std::size_t i = super + 1; i < super_counts_.size(); ++i) {
+            super_counts_[i] += static_cast<std::uint64_t>(delta);
+        }
+    }
+
+    std::size_t universe_ = 0;
+    std::size_t size_ = 0;
+    std::vector<std::uint64_t> words_;
+    std::vector<std::uint16_t> block_counts_;
+    std::vector<std::uint64_t> super_counts_;
+};
+
+} // namespace rb
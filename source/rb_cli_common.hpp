@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+namespace rb {
+
+namespace detail {
+
+// Общие части драйверов rb_tree_cli, rb_tree_cli_iter и std_set_cli.
+
+// Первый блок арены сессии (1 МиБ); следующие арена запрашивает сама,
+// увеличивая их геометрически.
+constexpr std::size_t session_arena_block = std::size_t{1} << 20;
+
+// Печатает ответ; ответы одной сессии разделяются пробелом.
+template <typename Value>
+void print_result(const Value& value, bool& first_output, std::ostream& output) {
+    if (!first_output) {
+        output << ' ';
+    }
+    output << value;
+    first_output = false;
+}
+
+} // namespace detail
+
+} // namespace rb
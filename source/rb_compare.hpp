@@ -0,0 +1,164 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#if defined(__has_include)
+#if __has_include(<compare>)
+#include <compare>
+#endif
+#endif
+
+namespace rb {
+
+namespace detail {
+
+template <typename Compare, typename = void>
+struct is_transparent : std::false_type {};
+
+template <typename Compare>
+struct is_transparent<Compare, std::void_t<typename Compare::is_transparent>>
+    : std::true_type {};
+
+template <typename Compare>
+inline constexpr bool is_transparent_v = is_transparent<Compare>::value;
+
+// Компаратор умеет трёхстороннее сравнение: compare(lhs, rhs) возвращает
+// значение, сравнимое с нулём (int, std::strong_ordering и т.п.).
+template <typename Compare, typename L, typename R, typename = void>
+struct has_three_way : std::false_type {};
+
+template <typename Compare, typename L, typename R>
+struct has_three_way<Compare,
+                     L,
+                     R,
+                     std::void_t<decltype(std::declval<const Compare&>().compare(
+                                              std::declval<const L&>(),
+                                              std::declval<const R&>()) < 0)>>
+    : std::true_type {};
+
+template <typename Compare, typename L, typename R>
+inline constexpr bool has_three_way_v = has_three_way<Compare, L, R>::value;
+
+template <typename L, typename R, typename = void>
+struct has_member_compare : std::false_type {};
+
+template <typename L, typename R>
+struct has_member_compare<
+    L,
+    R,
+    std::void_t<decltype(std::declval<const L&>().compare(
+                             std::declval<const R&>()) < 0)>>
+    : std::true_type {};
+
+#if defined(__cpp_impl_three_way_comparison) && \
+    defined(__cpp_lib_three_way_comparison)
+template <typename L, typename R, typename = void>
+struct has_spaceship : std::false_type {};
+
+template <typename L, typename R>
+struct has_spaceship<L,
+                     R,
+                     std::void_t<decltype(std::declval<const L&>() <=>
+                                          std::declval<const R&>())>>
+    : std::true_type {};
+#endif
+
+// Шаблонные перегрузки поиска по типу K доступны прозрачному компаратору
+// (и самому Key); иначе остаётся перегрузка с const Key&, которая приводит
+// аргумент к ключу, как std::set с std::less<Key>.
+template <typename Compare, typename Key, typename K>
+using enable_lookup_t =
+    std::enable_if_t<is_transparent_v<Compare> || std::is_same_v<K, Key>, int>;
+
+// Передаёт ключ поиска как есть для прозрачного компаратора,
+// иначе приводит его к Key.
+template <typename Key, typename Compare, typename K>
+decltype(auto) lookup_key(const K& value) {
+    if constexpr (is_transparent_v<Compare> || std::is_same_v<K, Key>) {
+        return (value);
+    } else {
+        return Key(value);
+    }
+}
+
+// lhs < rhs; целые разной знаковости сравниваются по значению, как
+// std::cmp_less из C++20, а не после приведения к беззнаковому типу.
+template <typename L, typename R>
+constexpr bool value_less(const L& lhs, const R& rhs) {
+    if constexpr (std::is_integral_v<L> && std::is_integral_v<R> &&
+                  std::is_signed_v<L> != std::is_signed_v<R>) {
+        if constexpr (std::is_signed_v<L>) {
+            return lhs < 0 || static_cast<std::make_unsigned_t<L>>(lhs) < rhs;
+        } else {
+            return rhs >= 0 && lhs < static_cast<std::make_unsigned_t<R>>(rhs);
+        }
+    } else {
+        return lhs < rhs;
+    }
+}
+
+// Трёхстороннее сравнение: знак результата как у strcmp. Использует
+// compare() компаратора, если он есть, иначе два вызова operator().
+template <typename Compare, typename L, typename R>
+auto three_way(const Compare& compare, const L& lhs, const R& rhs) {
+    if constexpr (has_three_way_v<Compare, L, R>) {
+        return compare.compare(lhs, rhs);
+    } else {
+        if (compare(lhs, rhs)) {
+            return -1;
+        }
+        return compare(rhs, lhs) ? 1 : 0;
+    }
+}
+
+} // namespace detail
+
+// Прозрачный компаратор по умолчанию. operator() сравнивает через <,
+// а compare() делает одно трёхстороннее сравнение: через метод compare()
+// (std::string, std::string_view), через <=> (C++20) или, если ни того ни
+// другого нет, через два вызова <.
+struct ThreeWayLess {
+    using is_transparent = void;
+
+    template <typename L, typename R>
+    bool operator()(const L& lhs, const R& rhs) const {
+        return detail::value_less(lhs, rhs);
+    }
+
+    template <typename L, typename R>
+    int compare(const L& lhs, const R& rhs) const {
+        if constexpr (std::is_arithmetic_v<L> && std::is_arithmetic_v<R>) {
+            return detail::value_less(rhs, lhs) - detail::value_less(lhs, rhs);
+        } else if constexpr (detail::has_member_compare<L, R>::value) {
+            const auto result = lhs.compare(rhs);
+            return (result > 0) - (result < 0);
+#if defined(__cpp_impl_three_way_comparison) && \
+    defined(__cpp_lib_three_way_comparison)
+        } else if constexpr (detail::has_spaceship<L, R>::value) {
+            const auto result = lhs <=> rhs;
+            return (result > 0) - (result < 0);
+#endif
+        } else {
+            if (lhs < rhs) {
+                return -1;
+            }
+            return rhs < lhs ? 1 : 0;
+        }
+    }
+};
+
+// Компаратор по умолчанию для ключей T: то же сравнение, что у
+// ThreeWayLess, но непрозрачный. Аргументы поиска приводятся к T, как у
+// std::less<T>; разнотипный поиск включается явным ThreeWayLess или
+// std::less<>.
+template <typename T>
+struct KeyLess {
+    bool operator()(const T& lhs, const T& rhs) const { return lhs < rhs; }
+
+    int compare(const T& lhs, const T& rhs) const {
+        return ThreeWayLess{}.compare(lhs, rhs);
+    }
+};
+
+} // namespace rb
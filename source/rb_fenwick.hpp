@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace rb {
+
+// Множество целых ключей из [0, universe) поверх дерева Фенвика: один
+// плоский массив 32-битных счётчиков и битовая карта присутствия. Вставка,
+// удаление и ранг стоят O(log U) без обхода указателей; шаг обновления —
+// прибавление младшего бита индекса, без ветвлений по данным.
+class FenwickSet {
+public:
+    using key_type = std::uint32_t;
+
+    // Создаёт пустое множество для ключей из [0, universe).
+    explicit FenwickSet(std::size_t universe = 0)
+        : universe_(universe),
+          counts_(universe + 1, 0),
+          present_((universe + 63) / 64, 0) {
+        assert(universe < 0xFFFFFFFFu);
+        while (top_step_ * 2 <= universe_) {
+            top_step_ *= 2;
+        }
+    }
+
+    std::size_t universe() const { return universe_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Вставляет ключ; false при дубликате или ключе вне [0, universe).
+    bool insert(key_type key) {
+        if (key >= universe_ || contains(key)) {
+            return false;
+        }
+        present_[key / 64] |= bit_of(key);
+        add(key, 1);
+        ++size_;
+        return true;
+    }
+
+    // Удаляет ключ; false, если его нет.
+    bool erase(key_type key) {
+        if (!contains(key)) {
+            return false;
+        }
+        present_[key / 64] &= ~bit_of(key);
+        add(key, static_cast<std::uint32_t>(-1));
+        --size_;
+        return true;
+    }
+
+    bool contains(key_type key) const {
+        return key < universe_ && (present_[key / 64] & bit_of(key)) != 0;
+    }
+
+    // Количество ключей, строго меньших key; значения вне [0, universe)
+    // прижимаются к границам.
+    template <typename K>
+    std::size_t rank(K key) const {
+        static_assert(std::is_integral_v<K>, "ключи FenwickSet — целые");
+        if constexpr (std::is_signed_v<K>) {
+            if (key <= 0) {
+                return 0;
+            }
+        }
+        if (static_cast<std::make_unsigned_t<K>>(key) >= universe_) {
+            return size_;
+        }
+        return prefix(static_cast<std::size_t>(key));
+    }
+
+    // Количество ключей в отрезке [first, second].
+    template <typename K>
+    std::size_t distance(K first, K second) const {
+        if (second < first) {
+            return 0;
+        }
+        if constexpr (std::is_signed_v<K>) {
+            if (second < 0) {
+                return 0;
+            }
+        }
+        const auto high = static_cast<std::make_unsigned_t<K>>(second);
+        const std::size_t high_rank =
+            high >= universe_ ? size_ : prefix(static_cast<std::size_t>(high) + 1);
+        return high_rank - rank(first);
+    }
+
+    // k-й по возрастанию ключ (с нуля) спуском по дереву Фенвика.
+    std::optional<key_type> select(std::size_t k) const {
+        if (k >= size_) {
+            return std::nullopt;
+        }
+        std::size_t position = 0;
+        std::size_t remaining = k;
+        for (std::size_t step = top_step_; step != 0; step /= 2) {
+            const std::size_t next = position + step;
+            if (next <= universe_ && counts_[next] <= remaining) {
+                position = next;
+                remaining -= counts_[next];
+            }
+        }
+        return static_cast<key_type>(position);
+    }
+
+    // Наименьший ключ, не меньший key.
+    template <typename K>
+    std::optional<key_type> lower_bound(K key) const {
+        return select(rank(key));
+    }
+
+private:
+    static std::uint64_t bit_of(std::size_t key) {
+        return std::uint64_t{1} << (key % 64);
+    }
+
+    void add(std::size_t key, std::uint32_t delta) {
+        for (std::size_t i = key + 1; i <= universe_; i += i & (~i + 1)) {
+            counts_[i] += delta;
+        }
+    }
+
+    // Количество ключей в [0, count).
+    std::size_t prefix(std::size_t count) const {
+        std::size_t result = 0;
+        for (std::size_t i = count; i > 0; i &= i - 1) {
+            result += counts_[i];
+        }
+        return result;
+    }
+
+    std::size_t universe_ = 0;
+    std::size_t size_ = 0;
+    std::size_t top_step_ = 1;
+    std::vector<std::uint32_t> counts_;
+    std::vector<std::uint64_t> present_;
+};
+
+} // namespace rb
@@ -0,0 +1,348 @@
+#pragma once
+
+#include "rb_path_tree.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rb {
+
+// Узел индексного хранилища: ссылки — 32-битные индексы в общем массиве,
+// цвет хранится в старшем бите размера поддерева. Для int узел занимает
+// 16 байт.
+template <typename T>
+struct IndexNode {
+    std::uint32_t left;
+    std::uint32_t right;
+    std::uint32_t meta;
+    T value;
+};
+
+// Хранилище узлов PathTree в одном непрерывном массиве. В узлах нет
+// указателей, поэтому массив можно копировать memcpy, расширять
+// перевыделением и сохранять на диск без правки ссылок. Освобождённые
+// ячейки связаны в список через left и переиспользуются при вставке.
+template <typename T>
+class IndexStorage {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "IndexStorage хранит узлы как сырые байты");
+
+public:
+    using handle = std::uint32_t;
+    using node_type = IndexNode<T>;
+
+    static constexpr handle nil() { return 0xFFFFFFFFu; }
+
+    // Наибольшее число узлов: размер поддерева занимает 31 бит.
+    static constexpr std::size_t max_nodes = 0x7FFFFFFFu;
+
+    // Создаёт красный лист с размером 1.
+    template <typename U>
+    handle create(U&& value) {
+        handle node;
+        if (free_head_ != nil()) {
+            node = free_head_;
+            free_head_ = nodes_[node].left;
+        } else {
+            assert(nodes_.size() < max_nodes);
+            node = static_cast<handle>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        nodes_[node] = node_type{nil(), nil(), red_bit | 1u,
+                                 T(std::forward<U>(value))};
+        return node;
+    }
+
+    // Возвращает ячейку в список свободных.
+    void destroy(handle node) {
+        nodes_[node].left = free_head_;
+        nodes_[node].meta = 0;
+        free_head_ = node;
+    }
+
+    handle left(handle node) const { return nodes_[node].left; }
+    handle right(handle node) const { return nodes_[node].right; }
+    void set_left(handle node, handle child) { nodes_[node].left = child; }
+    void set_right(handle node, handle child) { nodes_[node].right = child; }
+
+    bool red(handle node) const { return (nodes_[node].meta & red_bit) != 0; }
+
+    void set_red(handle node, bool red) {
+        auto& meta = nodes_[node].meta;
+        meta = red ? (meta | red_bit) : (meta & size_mask);
+    }
+
+    std::size_t size(handle node) const {
+        return nodes_[node].meta & size_mask;
+    }
+
+    void set_size(handle node, std::size_t size) {
+        assert(size <= size_mask);
+        auto& meta = nodes_[node].meta;
+        meta = (meta & red_bit) | static_cast<std::uint32_t>(size);
+    }
+
+    const T& value(handle node) const { return nodes_[node].value; }
+
+    // Освобождает все узлы сразу, корень не нужен.
+    void clear(handle) {
+        nodes_.clear();
+        free_head_ = nil();
+    }
+
+    // Копирует массив целиком: индексы остаются действительными.
+    handle clone(const IndexStorage& other, handle root) {
+        nodes_ = other.nodes_;
+        free_head_ = other.free_head_;
+        return root;
+    }
+
+    // Резервирует место под count узлов.
+    void reserve(std::size_t count) { nodes_.reserve(count); }
+
+    // Число занятых ячеек массива, включая освобождённые.
+    std::size_t capacity_used() const { return nodes_.size(); }
+
+    // Пишет массив узлов в поток как есть (порядок байт платформы).
+    bool write(std::ostream& out, handle root) const {
+        const std::uint64_t header[3] = {nodes_.size(), root, free_head_};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        if (!nodes_.empty()) {
+            out.write(reinterpret_cast<const char*>(nodes_.data()),
+                      static_cast<std::streamsize>(nodes_.size() *
+                                                   sizeof(node_type)));
+        }
+        return static_cast<bool>(out);
+    }
+
+    // Читает массив, записанный write; проверяет, что все индексы в
+    // пределах массива, а узлы дерева и список свободных без циклов и
+    // пересечений покрывают весь массив. Баланс и порядок ключей
+    // проверяет вызывающий.
+    bool read(std::istream& in, handle* root) {
+        std::uint64_t header[3] = {};
+        if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+            return false;
+        }
+        const std::uint64_t count = header[0];
+        if (count > max_nodes || !valid_link(header[1], count) ||
+            !valid_link(header[2], count)) {
+            return false;
+        }
+
+        std::vector<node_type> nodes(static_cast<std::size_t>(count));
+        if (count != 0 &&
+            !in.read(reinterpret_cast<char*>(nodes.data()),
+                     static_cast<std::streamsize>(count * sizeof(node_type)))) {
+            return false;
+        }
+        for (const auto& node : nodes) {
+            if (!valid_link(node.left, count) ||
+                !valid_link(node.right, count)) {
+                return false;
+            }
+        }
+        if (!partitions(nodes, static_cast<handle>(header[1]),
+                        static_cast<handle>(header[2]))) {
+            return false;
+        }
+
+        nodes_ = std::move(nodes);
+        free_head_ = static_cast<handle>(header[2]);
+        *root = static_cast<handle>(header[1]);
+        return true;
+    }
+
+private:
+    static constexpr std::uint32_t red_bit = 0x80000000u;
+    static constexpr std::uint32_t size_mask = 0x7FFFFFFFu;
+
+    static bool valid_link(std::uint64_t link, std::uint64_t count) {
+        return link == nil() || link < count;
+    }
+
+    // Каждая ячейка ровно один раз встречается либо в дереве от root, либо
+    // в списке свободных от free_head; иначе create выдал бы живой узел.
+    static bool partitions(const std::vector<node_type>& nodes,
+                           handle root,
+                           handle free_head) {
+        std::vector<bool> seen(nodes.size(), false);
+        std::size_t marked = 0;
+        for (handle node = free_head; node != nil(); node = nodes[node].left) {
+            if (seen[node]) {
+                return false;
+            }
+            seen[node] = true;
+            ++marked;
+        }
+
+        std::vector<handle> stack;
+        if (root != nil()) {
+            stack.push_back(root);
+        }
+        while (!stack.empty()) {
+            const handle node = stack.back();
+            stack.pop_back();
+            if (seen[node]) {
+                return false;
+            }
+            seen[node] = true;
+            ++marked;
+            for (handle child : {nodes[node].left, nodes[node].right}) {
+                if (child != nil()) {
+                    stack.push_back(child);
+                }
+            }
+        }
+        return marked == nodes.size();
+    }
+
+    std::vector<node_type> nodes_;
+    handle free_head_ = nil();
+};
+
+// Хранилище узлов PathTree в виде структуры массивов: ключи, пары
+// детей и размеры поддеревьев (с цветом в старшем бите) лежат в отдельных
+// параллельных массивах. Спуск читает только ключи и ссылки, так что
+// большие значения не вытесняют ссылки из кэша, а подсчёт рангов
+// дополнительно трогает лишь массив размеров.
+template <typename T>
+class SoaStorage {
+public:
+    using handle = std::uint32_t;
+
+    static constexpr handle nil() { return 0xFFFFFFFFu; }
+
+    static constexpr std::size_t max_nodes = 0x7FFFFFFFu;
+
+    // Создаёт красный лист с размером 1.
+    template <typename U>
+    handle create(U&& value) {
+        handle node;
+        if (free_head_ != nil()) {
+            node = free_head_;
+            free_head_ = links_[node].left;
+            keys_[node] = T(std::forward<U>(value));
+        } else {
+            assert(keys_.size() < max_nodes);
+            node = static_cast<handle>(keys_.size());
+            keys_.emplace_back(std::forward<U>(value));
+            links_.emplace_back();
+            meta_.emplace_back();
+        }
+        links_[node] = Links{nil(), nil()};
+        meta_[node] = red_bit | 1u;
+        return node;
+    }
+
+    // Возвращает ячейку в список свободных и освобождает ресурсы ключа.
+    void destroy(handle node) {
+        if constexpr (!std::is_trivially_destructible_v<T> &&
+                      std::is_default_constructible_v<T>) {
+            keys_[node] = T{};
+        }
+        links_[node].left = free_head_;
+        meta_[node] = 0;
+        free_head_ = node;
+    }
+
+    handle left(handle node) const { return links_[node].left; }
+    handle right(handle node) const { return links_[node].right; }
+    void set_left(handle node, handle child) { links_[node].left = child; }
+    void set_right(handle node, handle child) { links_[node].right = child; }
+
+    bool red(handle node) const { return (meta_[node] & red_bit) != 0; }
+
+    void set_red(handle node, bool red) {
+        auto& meta = meta_[node];
+        meta = red ? (meta | red_bit) : (meta & size_mask);
+    }
+
+    std::size_t size(handle node) const { return meta_[node] & size_mask; }
+
+    void set_size(handle node, std::size_t size) {
+        assert(size <= size_mask);
+        auto& meta = meta_[node];
+        meta = (meta & red_bit) | static_cast<std::uint32_t>(size);
+    }
+
+    const T& value(handle node) const { return keys_[node]; }
+
+    void clear(handle) {
+        keys_.clear();
+        links_.clear();
+        meta_.clear();
+        free_head_ = nil();
+    }
+
+    // Копирует массивы целиком: индексы остаются действительными.
+    handle clone(const SoaStorage& other, handle root) {
+        keys_ = other.keys_;
+        links_ = other.links_;
+        meta_ = other.meta_;
+        free_head_ = other.free_head_;
+        return root;
+    }
+
+    void reserve(std::size_t count) {
+        keys_.reserve(count);
+        links_.reserve(count);
+        meta_.reserve(count);
+    }
+
+    std::size_t capacity_used() const { return keys_.size(); }
+
+private:
+    struct Links {
+        std::uint32_t left;
+        std::uint32_t right;
+    };
+
+    static constexpr std::uint32_t red_bit = 0x80000000u;
+    static constexpr std::uint32_t size_mask = 0x7FFFFFFFu;
+
+    std::vector<T> keys_;
+    std::vector<Links> links_;
+    std::vector<std::uint32_t> meta_;
+    handle free_head_ = nil();
+};
+
+// PathTree с узлами в непрерывном массиве и 32-битными ссылками.
+template <typename T, typename Compare = KeyLess<T>>
+using IndexTree = PathTree<T, Compare, IndexStorage<T>>;
+
+// PathTree с ключами, ссылками и размерами в отдельных массивах.
+template <typename T, typename Compare = KeyLess<T>>
+using SoaTree = PathTree<T, Compare, SoaStorage<T>>;
+
+// Сохраняет дерево в двоичный поток.
+template <typename T, typename Compare>
+bool save(const IndexTree<T, Compare>& tree, std::ostream& out) {
+    return tree.storage().write(out, tree.root());
+}
+
+// Загружает дерево, сохранённое save; при ошибке формата или нарушенных
+// инвариантах возвращает false и не меняет tree.
+template <typename T, typename Compare>
+bool load(std::istream& in, IndexTree<T, Compare>& tree) {
+    IndexStorage<T> storage;
+    typename IndexStorage<T>::handle root = IndexStorage<T>::nil();
+    if (!storage.read(in, &root)) {
+        return false;
+    }
+
+    IndexTree<T, Compare> loaded(std::move(storage), root);
+    if (!loaded.is_valid()) {
+        return false;
+    }
+    tree = std::move(loaded);
+    return true;
+}
+
+} // namespace rb
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "rb_tree.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace rb {
+
+// Замкнутый отрезок [lo, hi], lo <= hi.
+template <typename T>
+struct Interval {
+    T lo;
+    T hi;
+
+    friend bool operator==(const Interval& lhs, const Interval& rhs) {
+        return !(lhs.lo < rhs.lo) && !(rhs.lo < lhs.lo) &&
+               !(lhs.hi < rhs.hi) && !(rhs.hi < lhs.hi);
+    }
+
+    friend bool operator!=(const Interval& lhs, const Interval& rhs) {
+        return !(lhs == rhs);
+    }
+};
+
+namespace detail {
+
+// Упорядочивает отрезки по левому концу, затем по правому. Прозрачен:
+// сравнение с одиночным T идёт только по левому концу.
+template <typename T>
+struct LowEndLess {
+    using is_transparent = void;
+
+    bool operator()(const Interval<T>& lhs, const Interval<T>& rhs) const {
+        return lhs.lo < rhs.lo || (!(rhs.lo < lhs.lo) && lhs.hi < rhs.hi);
+    }
+    bool operator()(const Interval<T>& lhs, const T& rhs) const {
+        return lhs.lo < rhs;
+    }
+    bool operator()(const T& lhs, const Interval<T>& rhs) const {
+        return lhs < rhs.lo;
+    }
+};
+
+// То же по правому концу.
+template <typename T>
+struct HighEndLess {
+    using is_transparent = void;
+
+    bool operator()(const Interval<T>& lhs, const Interval<T>& rhs) const {
+        return lhs.hi < rhs.hi || (!(rhs.hi < lhs.hi) && lhs.lo < rhs.lo);
+    }
+    bool operator()(const Interval<T>& lhs, const T& rhs) const {
+        return lhs.hi < rhs;
+    }
+    bool operator()(const T& lhs, const Interval<T>& rhs) const {
+        return lhs < rhs.hi;
+    }
+};
+
+// Наибольший правый конец в поддереве.
+template <typename T>
+struct MaxHighAugment {
+    using summary_type = T;
+
+    static summary_type identity() { return std::numeric_limits<T>::lowest(); }
+    static summary_type lift(const Interval<T>& value) { return value.hi; }
+    static summary_type combine(const summary_type& lhs,
+                                const summary_type& rhs) {
+        return lhs < rhs ? rhs : lhs;
+    }
+};
+
+} // namespace detail
+
+// Дерево отрезков на узлах rb::Tree. Отрезки упорядочены по левому концу,
+// а сводка узла хранит наибольший правый конец поддерева; повороты
+// пересчитывают её вместе с размером поддерева. Поиск пересечений
+// отбрасывает поддеревья, чей максимум левее запроса, и останавливается
+// на первом левом конце правее него: O(log n + k·log(n / k)) для k
+// найденных отрезков. Счётчики пересечений стоят O(log n): вторая копия
+// отрезков, упорядоченная по правому концу, даёт число отрезков целиком
+// левее запроса, ранги основного дерева — целиком правее. Одинаковые
+// отрезки хранятся один раз.
+template <typename T>
+class IntervalTree {
+public:
+    using value_type = Interval<T>;
+
+private:
+    using low_tree = Tree<value_type,
+                          detail::MaxHighAugment<T>,
+                          IdentityKey,
+                          detail::LowEndLess<T>>;
+    using high_tree =
+        Tree<value_type, NoAugment, IdentityKey, detail::HighEndLess<T>>;
+
+public:
+    using iterator = typename low_tree::iterator;
+
+    // Обход по возрастанию левого конца.
+    iterator begin() const { return by_low_.begin(); }
+    iterator end() const { return by_low_.end(); }
+
+    std::size_t size() const { return by_low_.size(); }
+    bool empty() const { return by_low_.empty(); }
+
+    // Вставляет отрезок [lo, hi]; false, если такой уже есть.
+    bool insert(const T& lo, const T& hi) {
+        assert(!(hi < lo));
+        const value_type interval{lo, hi};
+        if (!by_low_.insert(interval)) {
+            return false;
+        }
+        by_high_.insert(interval);
+        return true;
+    }
+
+    // Удаляет отрезок [lo, hi]; false, если его нет.
+    bool erase(const T& lo, const T& hi) {
+        const value_type interval{lo, hi};
+        if (!by_low_.erase(interval)) {
+            return false;
+        }
+        by_high_.erase(interval);
+        return true;
+    }
+
+    bool contains(const T& lo, const T& hi) const {
+        return by_low_.contains(value_type{lo, hi});
+    }
+
+    // Вызывает visit для каждого отрезка, пересекающего [lo, hi], по
+    // возрастанию левого конца.
+    template <typename Visitor>
+    void for_each_overlap(const T& lo, const T& hi, Visitor visit) const {
+        using node_base = typename low_tree::node_base;
+        std::vector<const node_base*> stack;
+        const node_base* node = by_low_.root_;
+        while (true) {
+            // Поддерево, чей наибольший правый конец левее lo, пропускается.
+            while (node != nullptr && !(by_low_.summary_of(node) < lo)) {
+                stack.push_back(node);
+                node = node->left_child();
+            }
+            if (stack.empty()) {
+                return;
+            }
+            node = stack.back();
+            stack.pop_back();
+            const value_type& interval = by_low_.as_node(node)->value();
+            if (hi < interval.lo) {
+                return;
+            }
+            if (!(interval.hi < lo)) {
+                visit(interval);
+            }
+            node = node->right_child();
+        }
+    }
+
+    // Отрезки, пересекающие [lo, hi].
+    std::vector<value_type> overlaps(const T& lo, const T& hi) const {
+        std::vector<value_type> result;
+        for_each_overlap(lo, hi, [&result](const value_type& interval) {
+            result.push_back(interval);
+        });
+        return result;
+    }
+
+    // Отрезки, содержащие point.
+    std::vector<value_type> stab(const T& point) const {
+        return overlaps(point, point);
+    }
+
+    // Количество отрезков, пересекающих [lo, hi], за O(log n).
+    std::size_t count_overlaps(const T& lo, const T& hi) const {
+        if (hi < lo) {
+            return 0;
+        }
+        const std::size_t ends_before = by_high_.rank(lo);
+        const std::size_t starts_after =
+            size() - by_low_.ranked_upper_bound(hi).rank();
+        return size() - ends_before - starts_after;
+    }
+
+    // Количество отрезков, содержащих point.
+    std::size_t count_stabbing(const T& point) const {
+        return count_overlaps(point, point);
+    }
+
+    bool is_valid() const {
+        return by_low_.size() == by_high_.size() && by_low_.is_valid() &&
+               by_high_.is_valid();
+    }
+
+private:
+    low_tree by_low_;
+    high_tree by_high_;
+};
+
+} // namespace rb
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "rb_tree.hpp"
+
+#include <cstddef>
+#include <utility>
+
+namespace rb {
+
+// Ассоциативный массив с порядковой статистикой поверх узлов rb::Tree.
+// Сравнение и поиск идут только по ключу, значение изменяемо на месте.
+// С прозрачным Compare все поисковые методы принимают любые сравнимые ключи.
+template <typename K, typename V, typename Compare = KeyLess<K>>
+class Map {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+
+private:
+    using tree_type = Tree<value_type, NoAugment, SelectFirst, Compare>;
+
+public:
+    using iterator = typename tree_type::iterator;
+
+    iterator begin() const { return tree_.begin(); }
+    iterator end() const { return tree_.end(); }
+
+    bool empty() const { return tree_.empty(); }
+    std::size_t size() const { return tree_.size(); }
+    bool is_valid() const { return tree_.is_valid(); }
+
+    // Добавляет пару; false, если ключ уже есть (значение не меняется).
+    bool insert(const K& key, const V& value) {
+        return tree_.insert(value_type(key, value));
+    }
+
+    bool insert(K&& key, V&& value) {
+        return tree_.insert(value_type(std::move(key), std::move(value)));
+    }
+
+    // Возвращает значение по ключу, вставляя V{} при отсутствии; новый
+    // узел подвешивается в место, найденное тем же спуском.
+    V& operator[](const K& key) {
+        auto location = tree_.locate(key);
+        if (location.exists) {
+            return value_of(location.parent);
+        }
+        return value_of(tree_.insert_at(value_type(key, V{}), location));
+    }
+
+    bool erase(const key_type& key) { return erase<key_type>(key); }
+
+    template <typename Q, detail::enable_lookup_t<Compare, key_type, Q> = 0>
+    bool erase(const Q& key) { return tree_.erase(key); }
+
+    bool contains(const key_type& key) const { return contains<key_type>(key); }
+
+    template <typename Q, detail::enable_lookup_t<Compare, key_type, Q> = 0>
+    bool contains(const Q& key) const { return tree_.contains(key); }
+
+    // Возвращает указатель на значение или nullptr, если ключа нет.
+    V* find(const key_type& key) { return find<key_type>(key); }
+
+    template <typename Q, detail::enable_lookup_t<Compare, key_type, Q> = 0>
+    V* find(const Q& key) {
+        auto location = tree_.locate(tree_type::lookup_key(key));
+        return location.exists ? &value_of(location.parent) : nullptr;
+    }
+
+    const V* find(const key_type& key) const { return find<key_type>(key); }
+
+    template <typename Q, detail::enable_lookup_t<Compare, key_type, Q> = 0>
+    const V* find(const Q& key) const {
+        auto location = tree_.locate(tree_type::lookup_key(key));
+        return location.exists ? &value_of(location.parent) : nullptr;
+    }
+
+    // k-я по возрастанию ключа пара (с нуля) или end(), если k >= size(),
+    // как у Tree::select. Значение меняется через find или operator[].
+    iterator select(std::size_t k) const { return tree_.select(k); }
+
+    // Количество ключей, строго меньших заданного.
+    std::size_t rank(const key_type& key) const { return rank<key_type>(key); }
+
+    template <typename Q, detail::enable_lookup_t<Compare, key_type, Q> = 0>
+    std::size_t rank(const Q& key) const { return tree_.rank(key); }
+
+    // Количество ключей в отрезке [first, second].
+    std::size_t distance(const key_type& first, const key_type& second) const {
+        return distance<key_type>(first, second);
+    }
+
+    template <typename Q, detail::enable_lookup_t<Compare, key_type, Q> = 0>
+    std::size_t distance(const Q& first, const Q& second) const {
+        return tree_.distance(first, second);
+    }
+
+    iterator lower_bound(const key_type& key) const {
+        return lower_bound<key_type>(key);
+    }
+
+    template <typename Q, detail::enable_lookup_t<Compare, key_type, Q> = 0>
+    iterator lower_bound(const Q& key) const { return tree_.lower_bound(key); }
+
+    iterator upper_bound(const key_type& key) const {
+        return upper_bound<key_type>(key);
+    }
+
+    template <typename Q, detail::enable_lookup_t<Compare, key_type, Q> = 0>
+    iterator upper_bound(const Q& key) const { return tree_.upper_bound(key); }
+
+private:
+    V& value_of(typename tree_type::node_base* node) {
+        return tree_.as_node(node)->value().second;
+    }
+
+    const V& value_of(const typename tree_type::node_base* node) const {
+        return tree_.as_node(node)->value().second;
+    }
+
+    tree_type tree_;
+};
+
+} // namespace rb
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace rb {
+
+namespace detail {
+
+// Поразрядная сортировка подходит целым ключам, упорядоченным обычным <.
+template <typename T>
+inline constexpr bool radix_sortable_v =
+    std::is_integral_v<T> && !std::is_same_v<T, bool>;
+
+// LSD-сортировка по байтам; знаковые ключи сортируются после инверсии
+// старшего бита. Пропускает проходы, в которых все ключи дают один байт.
+template <typename T>
+void radix_sort(T* first, T* last) {
+    using U = std::make_unsigned_t<T>;
+    constexpr U flip = std::is_signed_v<T>
+                           ? static_cast<U>(U{1} << (sizeof(T) * 8 - 1))
+                           : U{0};
+    const std::size_t count = static_cast<std::size_t>(last - first);
+    if (count < 2) {
+        return;
+    }
+
+    std::vector<T> buffer(count);
+    T* source = first;
+    T* target = buffer.data();
+    for (unsigned shift = 0; shift < sizeof(T) * 8; shift += 8) {
+        std::size_t histogram[256] = {};
+        for (std::size_t i = 0; i < count; ++i) {
+            ++histogram[((static_cast<U>(source[i]) ^ flip) >> shift) & 0xFFu];
+        }
+        if (std::any_of(std::begin(histogram), std::end(histogram),
+                        [count](std::size_t bucket) { return bucket == count; })) {
+            continue;
+        }
+        std::size_t offset = 0;
+        for (std::size_t& bucket : histogram) {
+            const std::size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto digit = ((static_cast<U>(source[i]) ^ flip) >> shift) & 0xFFu;
+            target[histogram[digit]++] = source[i];
+        }
+        std::swap(source, target);
+    }
+    if (source != first) {
+        std::copy(source, source + count, first);
+    }
+}
+
+// Запускает job(i) для i из [0, count) на отдельных потоках; последний
+// выполняется в вызывающем потоке. Исключения заданий перехватываются,
+// после того как все потоки присоединены, первое из них пробрасывается.
+template <typename Job>
+void run_parallel(std::size_t count, Job job) {
+    std::vector<std::exception_ptr> errors(count);
+    const auto guarded = [&job, &errors](std::size_t i) {
+        try {
+            job(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(count);
+    try {
+        for (std::size_t i = 0; i + 1 < count; ++i) {
+            workers.emplace_back(guarded, i);
+        }
+    } catch (...) {
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        throw;
+    }
+    if (count != 0) {
+        guarded(count - 1);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// Сортирует values на threads потоках: куски сортируются независимо
+// (поразрядно, если UseRadix), затем попарно сливаются раундами, в
+// каждом из которых слияния тоже идут параллельно.
+template <bool UseRadix, typename T, typename Less>
+void parallel_sort(std::vector<T>& values, unsigned threads, Less less) {
+    constexpr std::size_t min_chunk = std::size_t{1} << 14;
+    const std::size_t count = values.size();
+    const std::size_t chunks = std::max<std::size_t>(
+        1, std::min<std::size_t>(threads, count / min_chunk));
+
+    std::vector<std::size_t> bounds(chunks + 1);
+    for (std::size_t i = 0; i <= chunks; ++i) {
+        bounds[i] = count * i / chunks;
+    }
+
+    run_parallel(chunks, [&](std::size_t chunk) {
+        T* first = values.data() + bounds[chunk];
+        T* last = values.data() + bounds[chunk + 1];
+        if constexpr (UseRadix) {
+            radix_sort(first, last);
+        } else {
+            std::sort(first, last, less);
+        }
+    });
+
+    for (std::size_t width = 1; width < chunks; width *= 2) {
+        const std::size_t merges = (chunks + 2 * width - 1) / (2 * width);
+        run_parallel(merges, [&](std::size_t merge) {
+            const std::size_t left = merge * 2 * width;
+            const std::size_t middle = std::min(left + width, chunks);
+            const std::size_t right = std::min(left + 2 * width, chunks);
+            if (middle == right) {
+                return;
+            }
+            std::inplace_merge(
+                values.begin() + static_cast<std::ptrdiff_t>(bounds[left]),
+                values.begin() + static_cast<std::ptrdiff_t>(bounds[middle]),
+                values.begin() + static_cast<std::ptrdiff_t>(bounds[right]),
+                less);
+        });
+    }
+}
+
+} // namespace detail
+
+} // namespace rb
@@ -0,0 +1,829 @@
+#pragma once
+
+#include "rb_compare.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace rb {
+
+namespace detail {
+
+// Число значащих битов value: floor(log2(value)) + 1, 0 для нуля.
+constexpr std::size_t bit_length(std::size_t value) {
+    std::size_t bits = 0;
+    for (; value != 0; value >>= 1) {
+        ++bits;
+    }
+    return bits;
+}
+
+} // namespace detail
+
+// Узел без родительского указателя: ссылки на детей, размер поддерева и цвет.
+template <typename T>
+struct HeapNode {
+    template <typename U>
+    explicit HeapNode(U&& v) : value(std::forward<U>(v)) {}
+
+    HeapNode* left = nullptr;
+    HeapNode* right = nullptr;
+    std::size_t size = 1;
+    bool red = true;
+    T value;
+};
+
+// Хранилище узлов PathTree в куче: каждый узел выделяется отдельно,
+// дескриптор узла — обычный указатель.
+template <typename T>
+class HeapStorage {
+public:
+    using handle = HeapNode<T>*;
+
+    static constexpr handle nil() { return nullptr; }
+
+    HeapStorage() = default;
+    HeapStorage(const HeapStorage&) = delete;
+    HeapStorage& operator=(const HeapStorage&) = delete;
+    HeapStorage(HeapStorage&&) noexcept = default;
+    HeapStorage& operator=(HeapStorage&&) noexcept = default;
+
+    // Создаёт красный лист с размером 1.
+    template <typename U>
+    handle create(U&& value) {
+        return new HeapNode<T>(std::forward<U>(value));
+    }
+
+    void destroy(handle node) { delete node; }
+
+    handle left(handle node) const { return node->left; }
+    handle right(handle node) const { return node->right; }
+    void set_left(handle node, handle child) { node->left = child; }
+    void set_right(handle node, handle child) { node->right = child; }
+
+    bool red(handle node) const { return node->red; }
+    void set_red(handle node, bool red) { node->red = red; }
+
+    std::size_t size(handle node) const { return node->size; }
+    void set_size(handle node, std::size_t size) { node->size = size; }
+
+    const T& value(handle node) const { return node->value; }
+
+    // Освобождает все узлы поддерева.
+    void clear(handle root) {
+        if (root == nil()) {
+            return;
+        }
+        std::vector<handle> stack;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            handle current = stack.back();
+            stack.pop_back();
+            if (current->left != nil()) {
+                stack.push_back(current->left);
+            }
+            if (current->right != nil()) {
+                stack.push_back(current->right);
+            }
+            delete current;
+        }
+    }
+
+    // Копирует поддерево другого хранилища, возвращает новый корень.
+    handle clone(const HeapStorage& other, handle root) {
+        if (root == nil()) {
+            return nil();
+        }
+        handle copy = create(other.value(root));
+        copy->red = root->red;
+        copy->size = root->size;
+        copy->left = clone(other, root->left);
+        copy->right = clone(other, root->right);
+        return copy;
+    }
+};
+
+// Красно-чёрное дерево без родительских указателей. Вставка и удаление
+// запоминают путь от корня в массиве на стеке и восстанавливают баланс по
+// нему, итераторы хранят стек предков. Storage определяет, как хранятся
+// узлы и чем являются их дескрипторы.
+template <typename T,
+          typename Compare = KeyLess<T>,
+          typename Storage = HeapStorage<T>>
+class PathTree {
+public:
+    using value_type = T;
+    using key_type = T;
+    using key_compare = Compare;
+    using handle = typename Storage::handle;
+
+    // Высота красно-чёрного дерева не превышает 2·log2(n + 1); запас в два
+    // уровня нужен при исправлении после удаления.
+    static constexpr std::size_t max_depth =
+        2 * std::numeric_limits<std::size_t>::digits + 2;
+
+    // Сколько предков итератор хранит в себе; хватает деревьям высотой до
+    // 32, более глубокий путь продолжается в куче. Копия итератора
+    // обычного дерева не выделяет память и не тащит max_depth ссылок.
+    static constexpr std::size_t iterator_inline_depth = 32;
+
+    class iterator {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using reference = const T&;
+        using pointer = const T*;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        iterator() = default;
+
+        reference operator*() const {
+            assert(depth_ != 0);
+            return owner_->storage_.value(top());
+        }
+
+        pointer operator->() const {
+            return std::addressof(operator*());
+        }
+
+        iterator& operator++() {
+            assert(depth_ != 0);
+            handle current = top();
+            if (owner_->right(current) != nil()) {
+                push(owner_->right(current));
+                descend_left();
+                return *this;
+            }
+            handle child = nil();
+            do {
+                child = pop();
+            } while (depth_ != 0 && owner_->right(top()) == child);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        iterator& operator--() {
+            if (depth_ == 0) {
+                if (owner_->root_ != nil()) {
+                    push(owner_->root_);
+                    descend_right();
+                }
+                assert(depth_ != 0);
+                return *this;
+            }
+            handle current = top();
+            if (owner_->left(current) != nil()) {
+                push(owner_->left(current));
+                descend_right();
+                return *this;
+            }
+            handle child = nil();
+            do {
+                child = pop();
+            } while (depth_ != 0 && owner_->left(top()) == child);
+            assert(depth_ != 0);
+            return *this;
+        }
+
+        iterator operator--(int) {
+            auto tmp = *this;
+            --(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& rhs) const {
+            assert(owner_ == rhs.owner_);
+            return current() == rhs.current();
+        }
+
+        bool operator!=(const iterator& rhs) const {
+            return !(*this == rhs);
+        }
+
+    private:
+        explicit iterator(const PathTree* owner) : owner_(owner) {}
+
+        handle current() const { return depth_ == 0 ? nil() : top(); }
+
+        handle top() const {
+            return depth_ <= iterator_inline_depth
+                       ? stack_[depth_ - 1]
+                       : spill_[depth_ - 1 - iterator_inline_depth];
+        }
+
+        void push(handle node) {
+            assert(depth_ < max_depth);
+            if (depth_ < iterator_inline_depth) {
+                stack_[depth_] = node;
+            } else {
+                spill_.push_back(node);
+            }
+            ++depth_;
+        }
+
+        handle pop() {
+            const handle node = top();
+            truncate(depth_ - 1);
+            return node;
+        }
+
+        // Оставляет depth первых предков.
+        void truncate(std::size_t depth) {
+            depth_ = depth;
+            if (depth_ > iterator_inline_depth) {
+                spill_.resize(depth_ - iterator_inline_depth);
+            } else {
+                spill_.clear();
+            }
+        }
+
+        void descend_left() {
+            for (handle next = owner_->left(top()); next != nil();
+                 next = owner_->left(next)) {
+                push(next);
+            }
+        }
+
+        void descend_right() {
+            for (handle next = owner_->right(top()); next != nil();
+                 next = owner_->right(next)) {
+                push(next);
+            }
+        }
+
+        const PathTree* owner_ = nullptr;
+        std::array<handle, iterator_inline_depth> stack_{};
+        std::vector<handle> spill_;
+        std::size_t depth_ = 0;
+
+        friend class PathTree;
+    };
+
+    PathTree() = default;
+
+    // Инициализирует пустое дерево с заданным компаратором.
+    explicit PathTree(const Compare& compare) : compare_(compare) {}
+
+    // Принимает готовое хранилище с корнем root (например, после загрузки).
+    PathTree(Storage storage, handle root, const Compare& compare = Compare())
+        : storage_(std::move(storage)), root_(root), compare_(compare) {}
+
+    ~PathTree() { storage_.clear(root_); }
+
+    // Выполняет глубокое копирование.
+    PathTree(const PathTree& other)
+        : compare_(other.compare_) {
+        root_ = storage_.clone(other.storage_, other.root_);
+    }
+
+    // Перемещает данные из другого дерева.
+    PathTree(PathTree&& other) noexcept
+        : storage_(std::move(other.storage_)),
+          root_(std::exchange(other.root_, nil())),
+          compare_(other.compare_) {}
+
+    PathTree& operator=(const PathTree& other) {
+        if (this == &other) {
+            return *this;
+        }
+        PathTree tmp(other);
+        *this = std::move(tmp);
+        return *this;
+    }
+
+    PathTree& operator=(PathTree&& other) noexcept {
+        if (this != &other) {
+            PathTree temp(std::move(other));
+            std::swap(storage_, temp.storage_);
+            std::swap(root_, temp.root_);
+            std::swap(compare_, temp.compare_);
+        }
+        return *this;
+    }
+
+    iterator begin() const {
+        iterator it(this);
+        if (root_ != nil()) {
+            it.push(root_);
+            it.descend_left();
+        }
+        return it;
+    }
+
+    iterator end() const { return iterator(this); }
+
+    bool empty() const { return root_ == nil(); }
+
+    // Количество элементов в дереве.
+    std::size_t size() const { return node_size(root_); }
+
+    // Вставляет значение; false при дубликате.
+    bool insert(const T& value) { return insert_value(value); }
+    bool insert(T&& value) { return insert_value(std::move(value)); }
+
+    // Удаляет значение; false, если его нет.
+    bool erase(const key_type& value) {
+        return erase<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    bool erase(const K& value) {
+        return erase_key(lookup_key(value));
+    }
+
+    iterator find(const key_type& value) const {
+        return find<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    iterator find(const K& value) const {
+        const auto& key = lookup_key(value);
+        iterator it(this);
+        for (handle current = root_; current != nil();) {
+            it.push(current);
+            const auto order = compare3(key, storage_.value(current));
+            if (order == 0) {
+                return it;
+            }
+            current = order < 0 ? left(current) : right(current);
+        }
+        return end();
+    }
+
+    bool contains(const key_type& value) const {
+        return contains<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    bool contains(const K& value) const {
+        return find(value) != end();
+    }
+
+    iterator lower_bound(const key_type& value) const {
+        return lower_bound<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    iterator lower_bound(const K& value) const {
+        const auto& key = lookup_key(value);
+        return bound(
+            [&](const T& candidate) { return !compare_(candidate, key); });
+    }
+
+    iterator upper_bound(const key_type& value) const {
+        return upper_bound<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    iterator upper_bound(const K& value) const {
+        const auto& key = lookup_key(value);
+        return bound(
+            [&](const T& candidate) { return compare_(key, candidate); });
+    }
+
+    // Количество ключей, строго меньших заданного.
+    std::size_t rank(const key_type& value) const {
+        return rank<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    std::size_t rank(const K& value) const {
+        const auto& key = lookup_key(value);
+        return rank_by(
+            [&](const T& current) { return compare_(current, key); });
+    }
+
+    // Количество ключей в отрезке [first, second].
+    std::size_t distance(const key_type& first, const key_type& second) const {
+        return distance<key_type>(first, second);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    std::size_t distance(const K& first, const K& second) const {
+        const auto& low = lookup_key(first);
+        const auto& high = lookup_key(second);
+        if (compare_(high, low)) {
+            return 0;
+        }
+        const std::size_t low_rank = rank_by(
+            [&](const T& current) { return compare_(current, low); });
+        const std::size_t high_rank = rank_by(
+            [&](const T& current) { return !compare_(high, current); });
+        return high_rank - low_rank;
+    }
+
+    // Возвращает итератор на k-й по возрастанию элемент (с нуля) или end().
+    iterator select(std::size_t k) const {
+        iterator it(this);
+        for (handle current = root_; current != nil();) {
+            it.push(current);
+            const std::size_t left_size = node_size(left(current));
+            if (k < left_size) {
+                current = left(current);
+            } else if (k == left_size) {
+                return it;
+            } else {
+                k -= left_size + 1;
+                current = right(current);
+            }
+        }
+        return end();
+    }
+
+    // Проверяет цвета, чёрную высоту, порядок ключей и размеры поддеревьев.
+    // Обход итеративный, а глубина ограничена 2·log2(n + 1) + 2, поэтому
+    // испорченное дерево (например, из файла) отвергается без переполнения
+    // стека.
+    bool is_valid() const {
+        if (root_ == nil()) {
+            return true;
+        }
+        if (red(root_)) {
+            return false;
+        }
+        const std::size_t depth_limit = std::min(
+            max_depth, 2 * detail::bit_length(node_size(root_) + 1) + 2);
+
+        // Чёрная высота по левому краю; остальные пути сверяются с ней.
+        std::size_t black_height = 0;
+        std::size_t depth = 0;
+        for (handle node = root_; node != nil(); node = left(node)) {
+            if (++depth > depth_limit) {
+                return false;
+            }
+            black_height += red(node) ? 0 : 1;
+        }
+
+        struct Frame {
+            handle node;
+            const T* low;
+            const T* high;
+            std::size_t blacks;
+            std::size_t depth;
+        };
+        std::vector<Frame> stack;
+        stack.push_back({root_, nullptr, nullptr, 0, 1});
+        while (!stack.empty()) {
+            const Frame frame = stack.back();
+            stack.pop_back();
+            if (frame.node == nil()) {
+                if (frame.blacks != black_height) {
+                    return false;
+                }
+                continue;
+            }
+            if (frame.depth > depth_limit) {
+                return false;
+            }
+
+            const handle node = frame.node;
+            const T& value = storage_.value(node);
+            if ((frame.low != nullptr && !compare_(*frame.low, value)) ||
+                (frame.high != nullptr && !compare_(value, *frame.high))) {
+                return false;
+            }
+            if (red(node) && (red(left(node)) || red(right(node)))) {
+                return false;
+            }
+            if (storage_.size(node) !=
+                node_size(left(node)) + node_size(right(node)) + 1) {
+                return false;
+            }
+
+            const std::size_t blacks = frame.blacks + (red(node) ? 0 : 1);
+            stack.push_back({right(node), &value, frame.high, blacks,
+                             frame.depth + 1});
+            stack.push_back({left(node), frame.low, &value, blacks,
+                             frame.depth + 1});
+        }
+        return true;
+    }
+
+    // Доступ к хранилищу узлов (например, для сериализации).
+    const Storage& storage() const { return storage_; }
+    handle root() const { return root_; }
+
+private:
+    enum class Direction { LEFT, RIGHT };
+
+    // Путь от корня до текущего узла.
+    struct Path {
+        std::array<handle, max_depth> nodes;
+        std::size_t depth = 0;
+
+        void push(handle node) {
+            assert(depth < max_depth);
+            nodes[depth++] = node;
+        }
+
+        handle operator[](std::size_t index) const { return nodes[index]; }
+        handle& operator[](std::size_t index) { return nodes[index]; }
+    };
+
+    static constexpr handle nil() { return Storage::nil(); }
+
+    template <typename K>
+    static decltype(auto) lookup_key(const K& value) {
+        return detail::lookup_key<key_type, Compare>(value);
+    }
+
+    template <typename L, typename R>
+    auto compare3(const L& lhs, const R& rhs) const {
+        return detail::three_way(compare_, lhs, rhs);
+    }
+
+    handle left(handle node) const { return storage_.left(node); }
+    handle right(handle node) const { return storage_.right(node); }
+
+    // Цвет узла, считая nil чёрным.
+    bool red(handle node) const {
+        return node != nil() && storage_.red(node);
+    }
+
+    std::size_t node_size(handle node) const {
+        return node == nil() ? 0 : storage_.size(node);
+    }
+
+    void recalc_size(handle node) {
+        storage_.set_size(node,
+                          node_size(left(node)) + node_size(right(node)) + 1);
+    }
+
+    // Подвешивает replacement вместо old у родителя parent (nil — корень).
+    void replace_child(handle parent, handle old, handle replacement) {
+        if (parent == nil()) {
+            root_ = replacement;
+        } else if (left(parent) == old) {
+            storage_.set_left(parent, replacement);
+        } else {
+            storage_.set_right(parent, replacement);
+        }
+    }
+
+    // Поворачивает поддерево и возвращает его новый корень; ссылку
+    // родителя обновляет вызывающий.
+    handle rotate(handle node, Direction dir) {
+        handle pivot;
+        if (dir == Direction::LEFT) {
+            pivot = right(node);
+            storage_.set_right(node, left(pivot));
+            storage_.set_left(pivot, node);
+        } else {
+            pivot = left(node);
+            storage_.set_left(node, right(pivot));
+            storage_.set_right(pivot, node);
+        }
+        recalc_size(node);
+        recalc_size(pivot);
+        return pivot;
+    }
+
+    template <typename U>
+    bool insert_value(U&& value) {
+        Path path;
+        bool go_left = false;
+        for (handle current = root_; current != nil();) {
+            const auto order = compare3(value, storage_.value(current));
+            if (order == 0) {
+                return false;
+            }
+            path.push(current);
+            go_left = order < 0;
+            current = go_left ? left(current) : right(current);
+        }
+
+        handle node = storage_.create(std::forward<U>(value));
+        if (path.depth == 0) {
+            root_ = node;
+            storage_.set_red(node, false);
+            return true;
+        }
+
+        handle parent = path[path.depth - 1];
+        if (go_left) {
+            storage_.set_left(parent, node);
+        } else {
+            storage_.set_right(parent, node);
+        }
+        for (std::size_t i = 0; i < path.depth; ++i) {
+            storage_.set_size(path[i], storage_.size(path[i]) + 1);
+        }
+
+        path.push(node);
+        fix_insert(path);
+        return true;
+    }
+
+    // Восстанавливает баланс после вставки снизу вверх по пути.
+    void fix_insert(Path& path) {
+        std::size_t index = path.depth - 1;
+        while (index >= 2) {
+            handle node = path[index];
+            handle parent = path[index - 1];
+            if (!red(parent)) {
+                break;
+            }
+
+            handle grand = path[index - 2];
+            const bool parent_is_left = left(grand) == parent;
+            handle uncle = parent_is_left ? right(grand) : left(grand);
+            if (red(uncle)) {
+                storage_.set_red(parent, false);
+                storage_.set_red(uncle, false);
+                storage_.set_red(grand, true);
+                index -= 2;
+                continue;
+            }
+
+            const bool node_is_left = left(parent) == node;
+            if (node_is_left != parent_is_left) {
+                handle sub = rotate(parent, parent_is_left ? Direction::LEFT
+                                                           : Direction::RIGHT);
+                if (parent_is_left) {
+                    storage_.set_left(grand, sub);
+                } else {
+                    storage_.set_right(grand, sub);
+                }
+                parent = sub;
+            }
+
+            storage_.set_red(parent, false);
+            storage_.set_red(grand, true);
+            handle sub = rotate(grand, parent_is_left ? Direction::RIGHT
+                                                      : Direction::LEFT);
+            replace_child(index >= 3 ? path[index - 3] : nil(), grand, sub);
+            break;
+        }
+        storage_.set_red(root_, false);
+    }
+
+    template <typename K>
+    bool erase_key(const K& key) {
+        Path path;
+        handle target = root_;
+        while (target != nil()) {
+            const auto order = compare3(key, storage_.value(target));
+            if (order == 0) {
+                break;
+            }
+            path.push(target);
+            target = order < 0 ? left(target) : right(target);
+        }
+        if (target == nil()) {
+            return false;
+        }
+
+        const std::size_t target_index = path.depth;
+        handle target_parent = target_index > 0 ? path[target_index - 1] : nil();
+        path.push(target);
+
+        handle child = nil();
+        bool removed_red = false;
+        if (left(target) == nil() || right(target) == nil()) {
+            child = left(target) != nil() ? left(target) : right(target);
+            removed_red = red(target);
+            replace_child(target_parent, target, child);
+            path.depth = target_index;
+        } else {
+            // Преемник занимает место удаляемого узла вместе с его цветом.
+            handle successor = right(target);
+            path.push(successor);
+            while (left(successor) != nil()) {
+                successor = left(successor);
+                path.push(successor);
+            }
+            const std::size_t successor_index = path.depth - 1;
+            removed_red = red(successor);
+            child = right(successor);
+
+            if (successor_index != target_index + 1) {
+                storage_.set_left(path[successor_index - 1], child);
+                storage_.set_right(successor, right(target));
+            }
+            storage_.set_left(successor, left(target));
+            storage_.set_red(successor, red(target));
+            replace_child(target_parent, target, successor);
+            path[target_index] = successor;
+            path.depth = successor_index;
+        }
+        storage_.destroy(target);
+
+        for (std::size_t i = path.depth; i-- > 0;) {
+            recalc_size(path[i]);
+        }
+        if (!removed_red) {
+            fix_erase(path, child);
+        }
+        return true;
+    }
+
+    // Устраняет двойной чёрный у node, поднимаясь по пути к корню.
+    void fix_erase(Path& path, handle node) {
+        while (node != root_ && !red(node)) {
+            const std::size_t index = path.depth;
+            handle parent = path[index - 1];
+            const bool node_is_left = left(parent) == node;
+            handle sibling = node_is_left ? right(parent) : left(parent);
+
+            if (red(sibling)) {
+                storage_.set_red(sibling, false);
+                storage_.set_red(parent, true);
+                handle sub = rotate(parent, node_is_left ? Direction::LEFT
+                                                         : Direction::RIGHT);
+                replace_child(index >= 2 ? path[index - 2] : nil(), parent, sub);
+                // Брат стал дедом node: вставляем его в путь над parent.
+                path[index - 1] = sub;
+                path.push(parent);
+                sibling = node_is_left ? right(parent) : left(parent);
+            }
+
+            handle inner = node_is_left ? left(sibling) : right(sibling);
+            handle outer = node_is_left ? right(sibling) : left(sibling);
+            if (!red(inner) && !red(outer)) {
+                storage_.set_red(sibling, true);
+                node = parent;
+                --path.depth;
+                continue;
+            }
+
+            if (!red(outer)) {
+                storage_.set_red(inner, false);
+                storage_.set_red(sibling, true);
+                handle sub = rotate(sibling, node_is_left ? Direction::RIGHT
+                                                          : Direction::LEFT);
+                if (node_is_left) {
+                    storage_.set_right(parent, sub);
+                } else {
+                    storage_.set_left(parent, sub);
+                }
+                sibling = sub;
+                outer = node_is_left ? right(sibling) : left(sibling);
+            }
+
+            storage_.set_red(sibling, red(parent));
+            storage_.set_red(parent, false);
+            storage_.set_red(outer, false);
+            const std::size_t parent_index = path.depth - 1;
+            handle sub = rotate(parent, node_is_left ? Direction::LEFT
+                                                     : Direction::RIGHT);
+            replace_child(parent_index >= 1 ? path[parent_index - 1] : nil(),
+                          parent,
+                          sub);
+            node = root_;
+        }
+
+        if (node != nil()) {
+            storage_.set_red(node, false);
+        }
+    }
+
+    template <typename Predicate>
+    iterator bound(Predicate go_left) const {
+        iterator it(this);
+        std::size_t result_depth = 0;
+        for (handle current = root_; current != nil();) {
+            it.push(current);
+            if (go_left(storage_.value(current))) {
+                result_depth = it.depth_;
+                current = left(current);
+            } else {
+                current = right(current);
+            }
+        }
+        it.truncate(result_depth);
+        return it;
+    }
+
+    // Считает узлы, для которых go_right(значение узла) истинно.
+    template <typename Predicate>
+    std::size_t rank_by(Predicate go_right) const {
+        std::size_t result = 0;
+        for (handle current = root_; current != nil();) {
+            if (go_right(storage_.value(current))) {
+                result += node_size(left(current)) + 1;
+                current = right(current);
+            } else {
+                current = left(current);
+            }
+        }
+        return result;
+    }
+
+    Storage storage_;
+    handle root_ = nil();
+    Compare compare_;
+};
+
+} // namespace rb
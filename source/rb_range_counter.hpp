@@ -0,0 +1,126 @@
+#pragma once
+
+#include "rb_tree.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace rb {
+
+namespace detail {
+
+// Точки внутреннего дерева: (y, порядковый номер), чтобы совпадающие
+// точки считались по отдельности. Сравнение с одиночным Y идёт только
+// по координате.
+template <typename Y>
+struct PointYLess {
+    using is_transparent = void;
+    using entry = std::pair<Y, std::uint64_t>;
+
+    bool operator()(const entry& lhs, const entry& rhs) const {
+        return lhs.first < rhs.first ||
+               (!(rhs.first < lhs.first) && lhs.second < rhs.second);
+    }
+    bool operator()(const entry& lhs, const Y& rhs) const {
+        return lhs.first < rhs;
+    }
+    bool operator()(const Y& lhs, const entry& rhs) const {
+        return lhs < rhs.first;
+    }
+};
+
+} // namespace detail
+
+// Количество точек в прямоугольнике [x1, x2] × [y1, y2] при потоковых
+// вставках. Внешнее измерение — разреженное дерево Фенвика по целым X:
+// узел i хранит rb::Tree с координатами Y точек своего отрезка X, а
+// внутренний подсчёт — два ранговых спуска, как в Tree::distance. Вставка
+// и запрос стоят O(log U · log n), где U — размер диапазона X; память —
+// O(n log U), узлы Фенвика создаются только при первой точке.
+template <typename X, typename Y = X>
+class RangeCounter2D {
+    static_assert(std::is_integral_v<X> && sizeof(X) <= 4,
+                  "координаты X — целые не шире 32 бит");
+
+public:
+    using x_type = X;
+    using y_type = Y;
+
+    // Принимает точки с X из [min_x, max_x]; по умолчанию весь диапазон X.
+    explicit RangeCounter2D(X min_x = std::numeric_limits<X>::min(),
+                            X max_x = std::numeric_limits<X>::max())
+        : min_x_(min_x), universe_(offset(max_x) + 1) {
+        assert(!(max_x < min_x));
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Добавляет точку; совпадающие точки считаются несколько раз.
+    void insert(X x, const Y& y) {
+        assert(!(x < min_x_) && offset(x) < universe_);
+        const std::uint64_t id = size_++;
+        for (std::uint64_t i = offset(x) + 1; i <= universe_; i += i & (~i + 1)) {
+            columns_[i].insert({y, id});
+        }
+    }
+
+    // Количество точек в [x1, x2] × [y1, y2].
+    std::size_t count(X x1, X x2, const Y& y1, const Y& y2) const {
+        if (x2 < x1 || y2 < y1 || x2 < min_x_) {
+            return 0;
+        }
+        const std::uint64_t low = x1 < min_x_ ? 0 : offset(x1);
+        if (low >= universe_) {
+            return 0;
+        }
+        const std::uint64_t high = std::min(offset(x2) + 1, universe_);
+        return prefix(high, y1, y2) - prefix(low, y1, y2);
+    }
+
+    bool is_valid() const {
+        for (const auto& [index, column] : columns_) {
+            if (index == 0 || index > universe_ || !column.is_valid()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    using Column = Tree<std::pair<Y, std::uint64_t>,
+                        NoAugment,
+                        IdentityKey,
+                        detail::PointYLess<Y>>;
+
+    std::uint64_t offset(X x) const {
+        return static_cast<std::uint64_t>(static_cast<std::int64_t>(x) -
+                                          static_cast<std::int64_t>(min_x_));
+    }
+
+    // Точки с X-смещением из [0, count) и Y из [y1, y2].
+    std::size_t prefix(std::uint64_t count, const Y& y1, const Y& y2) const {
+        std::size_t result = 0;
+        for (std::uint64_t i = count; i > 0; i &= i - 1) {
+            const auto it = columns_.find(i);
+            if (it != columns_.end()) {
+                const Column& column = it->second;
+                result += column.ranked_upper_bound(y2).rank() - column.rank(y1);
+            }
+        }
+        return result;
+    }
+
+    X min_x_;
+    std::uint64_t universe_;
+    std::size_t size_ = 0;
+    std::unordered_map<std::uint64_t, Column> columns_;
+};
+
+} // namespace rb
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace rb {
+
+// Фоновый поток, выполняющий отложенные задачи освобождения памяти.
+// Деревья, которым назначен Reclaimer, отдают ему свои узлы при
+// уничтожении, очистке и присваивании за O(1), а обход и delete узлов
+// выполняются здесь. Reclaimer должен пережить все такие деревья;
+// деструктор дожидается выполнения всех задач.
+class Reclaimer {
+public:
+    Reclaimer() : worker_([this] { run(); }) {}
+
+    Reclaimer(const Reclaimer&) = delete;
+    Reclaimer& operator=(const Reclaimer&) = delete;
+
+    ~Reclaimer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        worker_.join();
+    }
+
+    // Ставит задачу в очередь фонового потока.
+    void defer(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        wake_.notify_one();
+    }
+
+    // Ждёт, пока очередь опустеет и текущая задача завершится.
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return tasks_.empty() && !busy_; });
+    }
+
+    // Количество задач, ещё не начатых фоновым потоком.
+    std::size_t pending() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tasks_.size();
+    }
+
+    // Общий экземпляр на процесс.
+    static Reclaimer& shared() {
+        static Reclaimer instance;
+        return instance;
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            std::function<void()> task = std::move(tasks_.front());
+            tasks_.pop_front();
+            busy_ = true;
+            lock.unlock();
+            task();
+            lock.lock();
+            busy_ = false;
+            if (tasks_.empty()) {
+                idle_.notify_all();
+            }
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<std::function<void()>> tasks_;
+    bool busy_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+};
+
+} // namespace rb
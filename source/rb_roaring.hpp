@@ -0,0 +1,507 @@
+#pragma once
+
+#include "rb_bitvector.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+namespace rb {
+
+namespace detail {
+
+// Контейнер младших 16 бит ключей одного чанка в стиле Roaring:
+//   ARRAY  — отсортированный массив, пока ключей не больше 4096;
+//   BITMAP — битовая карта на 65536 бит;
+//   RUN    — отсортированные отрезки [first, last], создаётся optimize().
+// Изменение RUN-контейнера сначала разворачивает его в ARRAY или BITMAP.
+class RoaringContainer {
+public:
+    enum class Kind { ARRAY, BITMAP, RUN };
+
+    static constexpr std::uint32_t array_limit = 4096;
+    static constexpr std::size_t bitmap_words = 65536 / 64;
+
+    Kind kind() const { return kind_; }
+    std::uint32_t cardinality() const { return cardinality_; }
+    bool empty() const { return cardinality_ == 0; }
+
+    bool contains(std::uint16_t low) const {
+        switch (kind_) {
+        case Kind::ARRAY:
+            return std::binary_search(array_.begin(), array_.end(), low);
+        case Kind::BITMAP:
+            return (bitmap_[low / 64] >> (low % 64)) & 1u;
+        case Kind::RUN: {
+            const auto run = run_after(low);
+            return run != runs_.begin() && std::prev(run)->last >= low;
+        }
+        }
+        return false;
+    }
+
+    // Вставляет значение; false, если оно уже есть.
+    bool insert(std::uint16_t low) {
+        if (kind_ == Kind::RUN) {
+            if (contains(low)) {
+                return false;
+            }
+            expand_runs();
+        }
+        if (kind_ == Kind::ARRAY) {
+            const auto it = std::lower_bound(array_.begin(), array_.end(), low);
+            if (it != array_.end() && *it == low) {
+                return false;
+            }
+            array_.insert(it, low);
+            ++cardinality_;
+            if (cardinality_ > array_limit) {
+                array_to_bitmap();
+            }
+            return true;
+        }
+        std::uint64_t& word = bitmap_[low / 64];
+        const std::uint64_t bit = std::uint64_t{1} << (low % 64);
+        if ((word & bit) != 0) {
+            return false;
+        }
+        word |= bit;
+        ++cardinality_;
+        return true;
+    }
+
+    // Удаляет значение; false, если его нет.
+    bool erase(std::uint16_t low) {
+        if (kind_ == Kind::RUN) {
+            if (!contains(low)) {
+                return false;
+            }
+            expand_runs();
+        }
+        if (kind_ == Kind::ARRAY) {
+            const auto it = std::lower_bound(array_.begin(), array_.end(), low);
+            if (it == array_.end() || *it != low) {
+                return false;
+            }
+            array_.erase(it);
+            --cardinality_;
+            return true;
+        }
+        std::uint64_t& word = bitmap_[low / 64];
+        const std::uint64_t bit = std::uint64_t{1} << (low % 64);
+        if ((word & bit) == 0) {
+            return false;
+        }
+        word &= ~bit;
+        --cardinality_;
+        if (cardinality_ <= array_limit) {
+            bitmap_to_array();
+        }
+        return true;
+    }
+
+    // Количество значений, строго меньших low.
+    std::uint32_t rank(std::uint16_t low) const {
+        switch (kind_) {
+        case Kind::ARRAY:
+            return static_cast<std::uint32_t>(
+                std::lower_bound(array_.begin(), array_.end(), low) -
+                array_.begin());
+        case Kind::BITMAP: {
+            std::uint32_t result = 0;
+            const std::size_t word = low / 64;
+            for (std::size_t i = 0; i < word; ++i) {
+                result += popcount64(bitmap_[i]);
+            }
+            const std::uint64_t mask = (std::uint64_t{1} << (low % 64)) - 1;
+            return result + popcount64(bitmap_[word] & mask);
+        }
+        case Kind::RUN: {
+            std::uint32_t result = 0;
+            for (const Run& run : runs_) {
+                if (run.first >= low) {
+                    break;
+                }
+                const std::uint32_t end =
+                    std::min<std::uint32_t>(run.last, low - 1u);
+                result += end - run.first + 1;
+            }
+            return result;
+        }
+        }
+        return 0;
+    }
+
+    // Наименьшее значение, не меньшее low.
+    std::optional<std::uint16_t> lower_bound(std::uint16_t low) const {
+        switch (kind_) {
+        case Kind::ARRAY: {
+            const auto it = std::lower_bound(array_.begin(), array_.end(), low);
+            if (it == array_.end()) {
+                return std::nullopt;
+            }
+            return *it;
+        }
+        case Kind::BITMAP: {
+            std::size_t word = low / 64;
+            std::uint64_t bits = bitmap_[word] & (~std::uint64_t{0} << (low % 64));
+            while (bits == 0) {
+                if (++word == bitmap_words) {
+                    return std::nullopt;
+                }
+                bits = bitmap_[word];
+            }
+            return static_cast<std::uint16_t>(word * 64 + lowest_bit(bits));
+        }
+        case Kind::RUN: {
+            const auto run = run_after(low);
+            if (run != runs_.begin() && std::prev(run)->last >= low) {
+                return low;
+            }
+            if (run == runs_.end()) {
+                return std::nullopt;
+            }
+            return run->first;
+        }
+        }
+        return std::nullopt;
+    }
+
+    // Наименьшее значение; контейнер не пуст.
+    std::uint16_t min() const {
+        assert(!empty());
+        return *lower_bound(0);
+    }
+
+    // Выбирает самое компактное представление, в том числе RUN.
+    void optimize() {
+        if (kind_ == Kind::RUN) {
+            return;
+        }
+        std::vector<Run> runs = collect_runs();
+        const std::size_t run_bytes = runs.size() * sizeof(Run);
+        const std::size_t plain_bytes =
+            kind_ == Kind::ARRAY ? array_.size() * sizeof(std::uint16_t)
+                                 : bitmap_words * sizeof(std::uint64_t);
+        if (run_bytes < plain_bytes) {
+            runs_ = std::move(runs);
+            array_ = {};
+            bitmap_ = {};
+            kind_ = Kind::RUN;
+        } else {
+            array_.shrink_to_fit();
+        }
+    }
+
+    // Байты, занятые данными контейнера.
+    std::size_t memory_usage() const {
+        return array_.capacity() * sizeof(std::uint16_t) +
+               bitmap_.capacity() * sizeof(std::uint64_t) +
+               runs_.capacity() * sizeof(Run);
+    }
+
+private:
+    struct Run {
+        std::uint16_t first;
+        std::uint16_t last;
+    };
+
+    static unsigned lowest_bit(std::uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+        unsigned index = 0;
+        while ((bits & 1u) == 0) {
+            bits >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    // Первый отрезок, начинающийся правее low.
+    std::vector<Run>::const_iterator run_after(std::uint16_t low) const {
+        return std::upper_bound(
+            runs_.begin(), runs_.end(), low,
+            [](std::uint16_t value, const Run& run) { return value < run.first; });
+    }
+
+    template <typename Visitor>
+    void for_each(Visitor visit) const {
+        if (kind_ == Kind::ARRAY) {
+            for (std::uint16_t value : array_) {
+                visit(value);
+            }
+        } else if (kind_ == Kind::BITMAP) {
+            for (std::size_t word = 0; word < bitmap_words; ++word) {
+                for (std::uint64_t bits = bitmap_[word]; bits != 0;
+                     bits &= bits - 1) {
+                    visit(static_cast<std::uint16_t>(word * 64 +
+                                                     lowest_bit(bits)));
+                }
+            }
+        } else {
+            for (const Run& run : runs_) {
+                for (std::uint32_t value = run.first; value <= run.last;
+                     ++value) {
+                    visit(static_cast<std::uint16_t>(value));
+                }
+            }
+        }
+    }
+
+    std::vector<Run> collect_runs() const {
+        std::vector<Run> runs;
+        for_each([&](std::uint16_t value) {
+            if (!runs.empty() && runs.back().last + 1u == value) {
+                runs.back().last = value;
+            } else {
+                runs.push_back(Run{value, value});
+            }
+        });
+        return runs;
+    }
+
+    void expand_runs() {
+        if (cardinality_ <= array_limit) {
+            array_.reserve(cardinality_);
+            for_each([&](std::uint16_t value) { array_.push_back(value); });
+            kind_ = Kind::ARRAY;
+        } else {
+            bitmap_.assign(bitmap_words, 0);
+            for_each([&](std::uint16_t value) {
+                bitmap_[value / 64] |= std::uint64_t{1} << (value % 64);
+            });
+            kind_ = Kind::BITMAP;
+        }
+        runs_ = {};
+    }
+
+    void array_to_bitmap() {
+        bitmap_.assign(bitmap_words, 0);
+        for (std::uint16_t value : array_) {
+            bitmap_[value / 64] |= std::uint64_t{1} << (value % 64);
+        }
+        array_ = {};
+        kind_ = Kind::BITMAP;
+    }
+
+    void bitmap_to_array() {
+        std::vector<std::uint16_t> values;
+        values.reserve(cardinality_);
+        for_each([&](std::uint16_t value) { values.push_back(value); });
+        array_ = std::move(values);
+        bitmap_ = {};
+        kind_ = Kind::ARRAY;
+    }
+
+    Kind kind_ = Kind::ARRAY;
+    std::uint32_t cardinality_ = 0;
+    std::vector<std::uint16_t> array_;
+    std::vector<std::uint64_t> bitmap_;
+    std::vector<Run> runs_;
+};
+
+} // namespace detail
+
+// Упорядоченное множество 32-битных ключей из сжатых контейнеров в стиле
+// Roaring: ключи делятся на чанки по старшим 16 битам, каждый чанк хранится
+// массивом, битовой картой или отрезками. Для рангов поверх чанков
+// поддерживается дерево Фенвика с мощностями контейнеров, так что rank и
+// distance стоят O(log C) плюс ранг внутри одного контейнера.
+class RoaringSet {
+public:
+    using key_type = std::uint32_t;
+    using container_kind = detail::RoaringContainer::Kind;
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Вставляет ключ; false при дубликате.
+    bool insert(key_type key) {
+        const std::uint16_t high = high_of(key);
+        auto it = std::lower_bound(highs_.begin(), highs_.end(), high);
+        std::size_t index = static_cast<std::size_t>(it - highs_.begin());
+        const bool created = it == highs_.end() || *it != high;
+        if (created) {
+            highs_.insert(it, high);
+            containers_.insert(
+                containers_.begin() + static_cast<std::ptrdiff_t>(index),
+                detail::RoaringContainer());
+        }
+        const bool inserted = containers_[index].insert(low_of(key));
+        if (inserted) {
+            ++size_;
+            if (created) {
+                rebuild_counts();
+            } else {
+                add_count(index, 1);
+            }
+        }
+        return inserted;
+    }
+
+    // Удаляет ключ; false, если его нет.
+    bool erase(key_type key) {
+        const std::size_t index = chunk_of(high_of(key));
+        if (index == highs_.size() || !containers_[index].erase(low_of(key))) {
+            return false;
+        }
+        --size_;
+        if (containers_[index].empty()) {
+            highs_.erase(highs_.begin() + static_cast<std::ptrdiff_t>(index));
+            containers_.erase(containers_.begin() +
+                              static_cast<std::ptrdiff_t>(index));
+            rebuild_counts();
+        } else {
+            add_count(index, -1);
+        }
+        return true;
+    }
+
+    bool contains(key_type key) const {
+        const std::size_t index = chunk_of(high_of(key));
+        return index != highs_.size() && containers_[index].contains(low_of(key));
+    }
+
+    // Количество ключей, строго меньших key.
+    std::size_t rank(key_type key) const {
+        const std::uint16_t high = high_of(key);
+        const auto it = std::lower_bound(highs_.begin(), highs_.end(), high);
+        const std::size_t index = static_cast<std::size_t>(it - highs_.begin());
+        std::size_t result = prefix_count(index);
+        if (it != highs_.end() && *it == high) {
+            result += containers_[index].rank(low_of(key));
+        }
+        return result;
+    }
+
+    // Количество ключей в отрезке [first, second].
+    std::size_t distance(key_type first, key_type second) const {
+        if (second < first) {
+            return 0;
+        }
+        const std::size_t high = second == max_key ? size_ : rank(second + 1);
+        return high - rank(first);
+    }
+
+    // Наименьший ключ, не меньший key.
+    std::optional<key_type> lower_bound(key_type key) const {
+        const std::uint16_t high = high_of(key);
+        auto it = std::lower_bound(highs_.begin(), highs_.end(), high);
+        std::size_t index = static_cast<std::size_t>(it - highs_.begin());
+        if (it != highs_.end() && *it == high) {
+            if (const auto low = containers_[index].lower_bound(low_of(key))) {
+                return join(high, *low);
+            }
+            ++index;
+        }
+        if (index == highs_.size()) {
+            return std::nullopt;
+        }
+        return join(highs_[index], containers_[index].min());
+    }
+
+    // Наименьший ключ, строго больший key.
+    std::optional<key_type> upper_bound(key_type key) const {
+        if (key == max_key) {
+            return std::nullopt;
+        }
+        return lower_bound(key + 1);
+    }
+
+    // Переводит контейнеры в самое компактное представление, включая
+    // отрезки; стоит вызывать после массовой загрузки.
+    void optimize() {
+        for (auto& container : containers_) {
+            container.optimize();
+        }
+        highs_.shrink_to_fit();
+        containers_.shrink_to_fit();
+        counts_.shrink_to_fit();
+    }
+
+    // Тип контейнера, хранящего ключ key (или его чанк).
+    std::optional<container_kind> container_of(key_type key) const {
+        const std::size_t index = chunk_of(high_of(key));
+        if (index == highs_.size()) {
+            return std::nullopt;
+        }
+        return containers_[index].kind();
+    }
+
+    // Приблизительный объём памяти в байтах.
+    std::size_t memory_usage() const {
+        std::size_t bytes = sizeof(*this) +
+                            highs_.capacity() * sizeof(std::uint16_t) +
+                            containers_.capacity() *
+                                sizeof(detail::RoaringContainer) +
+                            counts_.capacity() * sizeof(std::size_t);
+        for (const auto& container : containers_) {
+            bytes += container.memory_usage();
+        }
+        return bytes;
+    }
+
+private:
+    static constexpr key_type max_key = 0xFFFFFFFFu;
+
+    static std::uint16_t high_of(key_type key) {
+        return static_cast<std::uint16_t>(key >> 16);
+    }
+
+    static std::uint16_t low_of(key_type key) {
+        return static_cast<std::uint16_t>(key & 0xFFFFu);
+    }
+
+    static key_type join(std::uint16_t high, std::uint16_t low) {
+        return (static_cast<key_type>(high) << 16) | low;
+    }
+
+    // Индекс чанка high или highs_.size(), если его нет.
+    std::size_t chunk_of(std::uint16_t high) const {
+        const auto it = std::lower_bound(highs_.begin(), highs_.end(), high);
+        if (it == highs_.end() || *it != high) {
+            return highs_.size();
+        }
+        return static_cast<std::size_t>(it - highs_.begin());
+    }
+
+    // Дерево Фенвика по мощностям контейнеров (индексация с единицы).
+    void rebuild_counts() {
+        counts_.assign(containers_.size() + 1, 0);
+        for (std::size_t i = 1; i < counts_.size(); ++i) {
+            counts_[i] += containers_[i - 1].cardinality();
+            const std::size_t parent = i + (i & (~i + 1));
+            if (parent < counts_.size()) {
+                counts_[parent] += counts_[i];
+            }
+        }
+    }
+
+    void add_count(std::size_t index, int delta) {
+        for (std::size_t i = index + 1; i < counts_.size(); i += i & (~i + 1)) {
+            counts_[i] += static_cast<std::size_t>(delta);
+        }
+    }
+
+    // Суммарная мощность контейнеров [0, count).
+    std::size_t prefix_count(std::size_t count) const {
+        std::size_t result = 0;
+        for (std::size_t i = count; i > 0; i -= i & (~i + 1)) {
+            result += counts_[i];
+        }
+        return result;
+    }
+
+    std::size_t size_ = 0;
+    std::vector<std::uint16_t> highs_;
+    std::vector<detail::RoaringContainer> containers_;
+    std::vector<std::size_t> counts_{0};
+};
+
+} // namespace rb
@@ -2,6 +2,10 @@
 
 #include <iostream>
 
-int main() {
-    return rb::run_cli(std::cin, std::cout, std::cerr);
+int main(int argc, char* argv[]) {
+    rb::CliOptions options;
+    if (!rb::parse_cli_options(argc, argv, options, std::cerr)) {
+        return 1;
+    }
+    return rb::run_cli(std::cin, std::cout, std::cerr, options);
 }
@@ -1,29 +1,97 @@
 #pragma once
 
+#include "rb_augment.hpp"
+#include "rb_compare.hpp"
+#include "rb_parallel_sort.hpp"
+#include "rb_reclaimer.hpp"
+
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <memory_resource>
+#include <thread>
 #include <vector>
 #include <type_traits>
 #include <iterator>
+#include <unordered_map>
 #include <utility>
 
 namespace rb {
 
-template <typename T>
+// Свойства узла: ширина счётчика размера поддерева или его отсутствие.
+// Счётчик нужен для ранговых запросов (distance, rank, select).
+template <typename SizeType>
+struct CountedNodes {
+    using size_type = SizeType;
+    static constexpr bool counted = true;
+};
+
+// Режим простого множества: счётчиков нет, ранговые запросы недоступны,
+// вставка и удаление не поддерживают размеры поддеревьев.
+struct UncountedNodes {
+    using size_type = void;
+    static constexpr bool counted = false;
+};
+
+using DefaultNodeTraits = CountedNodes<std::size_t>;
+// 32-битный счётчик для деревьев до 4G ключей.
+using CompactNodeTraits = CountedNodes<std::uint32_t>;
+
+template <typename T, typename Augment, typename Traits>
 class Node;
 
+template <typename K, typename V, typename Compare>
+class Map;
+
+template <typename T>
+class IntervalTree;
+
+namespace detail {
+
+// Заглушка счётчика для узлов без размеров поддеревьев.
+struct NoCounter {};
+
+template <typename T, typename = void>
+struct is_equality_comparable : std::false_type {};
+
 template <typename T>
+struct is_equality_comparable<
+    T,
+    std::void_t<decltype(std::declval<const T&>() == std::declval<const T&>())>>
+    : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_equality_comparable_v = is_equality_comparable<T>::value;
+
+// Просит процессор заранее загрузить строку кэша; nullptr допустим.
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void)address;
+#endif
+}
+
+} // namespace detail
+
+template <typename T, typename Traits = DefaultNodeTraits>
 class NodeBase {
 public:
-    enum class Color {
+    enum class Color : unsigned char {
         RED,
         BLACK,
     };
 
-    template <typename>
+    using counter_type = std::conditional_t<Traits::counted,
+                                            typename Traits::size_type,
+                                            detail::NoCounter>;
+
+    template <typename, typename, typename, typename, typename>
     friend class Tree;
 
     Color color() const { return color_; }
@@ -41,8 +109,8 @@ public:
     NodeBase* parent() { return parent_; }
     void set_parent(NodeBase* p) { parent_ = p; }
 
-    std::size_t subtree_size() const { return subtree_size_; }
-    void set_subtree_size(std::size_t size) { subtree_size_ = size; }
+    counter_type subtree_size() const { return subtree_size_; }
+    void set_subtree_size(counter_type size) { subtree_size_ = size; }
 
 protected:
     NodeBase(Color c,
@@ -50,40 +118,53 @@ protected:
              NodeBase* r,
              NodeBase* p,
              std::size_t subtree_size = 0)
-        : color_(c),
-          left_(l),
+        : left_(l),
           right_(r),
           parent_(p),
-          subtree_size_(subtree_size) {}
+          subtree_size_(initial_counter(subtree_size)),
+          color_(c) {}
 
     virtual ~NodeBase() {}
 
 private:
-    Color color_;
+    static counter_type initial_counter(std::size_t size) {
+        if constexpr (Traits::counted) {
+            return static_cast<counter_type>(size);
+        } else {
+            return counter_type{};
+        }
+    }
+
+    // Узкие поля идут последними, чтобы значение узла заняло их выравнивание.
     NodeBase* left_;
     NodeBase* right_;
     NodeBase* parent_;
-    std::size_t subtree_size_;
+    counter_type subtree_size_;
+    Color color_;
 };
 
-template <typename T>
-class Node : public NodeBase<T> {
+template <typename T,
+          typename Augment = NoAugment,
+          typename Traits = DefaultNodeTraits>
+class Node : public NodeBase<T, Traits>, public NodeSummary<Augment> {
+    using base = NodeBase<T, Traits>;
+
 public:
     // Создаёт узел с копированием значения.
     Node(const T& v,
-         typename NodeBase<T>::Color c = NodeBase<T>::Color::RED,
-         NodeBase<T>* l = nullptr,
-         NodeBase<T>* r = nullptr,
-         NodeBase<T>* p = nullptr)
-        : NodeBase<T>(c, l, r, p, 1), value_(v) {}
+         typename base::Color c = base::Color::RED,
+         base* l = nullptr,
+         base* r = nullptr,
+         base* p = nullptr)
+        : base(c, l, r, p, 1), value_(v) {}
 
     // Создаёт узел с перемещением значения.
     Node(T&& v,
-         typename NodeBase<T>::Color c = NodeBase<T>::Color::RED,
-         NodeBase<T>* l = nullptr,
-         NodeBase<T>* r = nullptr,
-         NodeBase<T>* p = nullptr)
-        : NodeBase<T>(c, l, r, p, 1), value_(std::move(v)) {}
+         typename base::Color c = base::Color::RED,
+         base* l = nullptr,
+         base* r = nullptr,
+         base* p = nullptr)
+        : base(c, l, r, p, 1), value_(std::move(v)) {}
 
     const T& value() const { return value_; }
     T& value() { return value_; }
@@ -104,12 +185,62 @@ bool compare_upper_bound(const T& first, const T& second) {
     return first <= second;
 }
 
-template <typename T>
+// Ключ совпадает с хранимым значением.
+struct IdentityKey {
+    template <typename U>
+    const U& operator()(const U& value) const { return value; }
+};
+
+// Ключом служит первый элемент пары.
+struct SelectFirst {
+    template <typename Pair>
+    const typename Pair::first_type& operator()(const Pair& value) const {
+        return value.first;
+    }
+};
+
+namespace detail {
+
+template <typename T, typename KeyOf>
+using key_of_t = std::decay_t<
+    decltype(std::declval<const KeyOf&>()(std::declval<const T&>()))>;
+
+} // namespace detail
+
+// Метка конструктора Tree: при уничтожении, очистке и присваивании узлы не
+// обходятся и не отдаются ресурсу по одному — их память вернёт сам ресурс
+// (арена или пул поверх неё). Элементы и сводки должны быть тривиально
+// разрушаемыми.
+struct release_nodes_with_resource_t {
+    explicit release_nodes_with_resource_t() = default;
+};
+
+inline constexpr release_nodes_with_resource_t release_nodes_with_resource{};
+
+// Compare задаёт строгий порядок ключей; по умолчанию KeyLess, и аргументы
+// поиска приводятся к key_type. Прозрачный компаратор (с is_transparent,
+// как ThreeWayLess или std::less<>) позволяет искать по любому типу,
+// сравнимому с key_type, без создания временного ключа. Если у компаратора
+// есть compare(lhs, rhs), спуски делают одно трёхстороннее сравнение на
+// уровень вместо двух вызовов <. Traits выбирает ширину счётчика размера
+// поддерева (CountedNodes) или режим без счётчиков (UncountedNodes).
+template <typename T,
+          typename Augment = NoAugment,
+          typename KeyOf = IdentityKey,
+          typename Compare = KeyLess<detail::key_of_t<T, KeyOf>>,
+          typename Traits = DefaultNodeTraits>
 class Tree {
+    using node_base = NodeBase<T, Traits>;
+
 public:
     enum class Direction { LEFT, RIGHT };
     class iterator;
 
+    using value_type = T;
+    using key_type = detail::key_of_t<T, KeyOf>;
+    using summary_type = typename Augment::summary_type;
+    using key_compare = Compare;
+
     static_assert(std::is_copy_constructible_v<T>,
                   "rb::Tree<T> requires T to be copy-constructible");
     static_assert(std::is_move_constructible_v<T>,
@@ -118,10 +249,11 @@ public:
                   "rb::Tree<T> requires T to be copy-assignable");
     static_assert(std::is_move_assignable_v<T>,
                   "rb::Tree<T> requires T to be move-assignable");
-    static_assert(std::is_convertible_v<
-                      decltype(std::declval<const T&>() < std::declval<const T&>()),
-                      bool>,
-                  "rb::Tree<T> requires operator< to establish a strict ordering");
+    static_assert(std::is_invocable_r_v<bool,
+                                        const Compare&,
+                                        const key_type&,
+                                        const key_type&>,
+                  "rb::Tree<T> requires Compare to establish a strict ordering");
 
     class iterator {
     public:
@@ -180,15 +312,237 @@ public:
         }
 
     private:
-        iterator(const Tree* owner, NodeBase<T>* current)
+        iterator(const Tree* owner, node_base* current)
             : owner_(owner), current_(current) {}
 
         const Tree* owner_ = nullptr;
-        NodeBase<T>* current_ = nullptr;
+        node_base* current_ = nullptr;
+
+        friend class Tree;
+    };
+
+    // Итератор, который знает свой ранг в упорядоченном обходе. Ранг
+    // вычисляется тем же спуском, что и позиция, и сдвигается на единицу
+    // при ++ и --, поэтому rank() и разность итераторов стоят O(1).
+    // Изменение дерева делает ранги недействительными.
+    class ranked_iterator {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using reference = const T&;
+        using pointer = const T*;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        ranked_iterator() = default;
+
+        reference operator*() const { return *base_; }
+        pointer operator->() const { return base_.operator->(); }
+
+        ranked_iterator& operator++() {
+            ++base_;
+            ++rank_;
+            return *this;
+        }
+
+        ranked_iterator operator++(int) {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        ranked_iterator& operator--() {
+            --base_;
+            --rank_;
+            return *this;
+        }
+
+        ranked_iterator operator--(int) {
+            auto tmp = *this;
+            --(*this);
+            return tmp;
+        }
+
+        // Количество элементов перед позицией; size() для конца.
+        size_t rank() const { return rank_; }
+
+        // Обычный итератор на ту же позицию.
+        iterator base() const { return base_; }
+
+        difference_type operator-(const ranked_iterator& rhs) const {
+            return static_cast<difference_type>(rank_) -
+                   static_cast<difference_type>(rhs.rank_);
+        }
+
+        bool operator==(const ranked_iterator& rhs) const {
+            return base_ == rhs.base_;
+        }
+
+        bool operator!=(const ranked_iterator& rhs) const {
+            return !(*this == rhs);
+        }
+
+    private:
+        ranked_iterator(iterator base, size_t rank) : base_(base), rank_(rank) {}
+
+        iterator base_;
+        size_t rank_ = 0;
+
+        friend class Tree;
+    };
+
+    // Узел, извлечённый из дерева вместе со значением, — аналог node_type
+    // у std::set. Его можно вставить в другое дерево того же типа без
+    // выделения памяти и копирования значения. Непустой дескриптор при
+    // уничтожении освобождает узел в ресурсе исходного дерева.
+    class node_type {
+    public:
+        node_type() = default;
+
+        node_type(node_type&& other) noexcept
+            : node_(std::exchange(other.node_, nullptr)),
+              resource_(other.resource_) {}
+
+        node_type& operator=(node_type&& other) noexcept {
+            if (this != &other) {
+                reset();
+                node_ = std::exchange(other.node_, nullptr);
+                resource_ = other.resource_;
+            }
+            return *this;
+        }
+
+        node_type(const node_type&) = delete;
+        node_type& operator=(const node_type&) = delete;
+
+        ~node_type() { reset(); }
+
+        bool empty() const { return node_ == nullptr; }
+        explicit operator bool() const { return !empty(); }
+
+        // Значение можно менять, пока узел не в дереве.
+        T& value() const {
+            assert(node_ != nullptr);
+            return node_->value();
+        }
+
+    private:
+        node_type(Node<T, Augment, Traits>* node,
+                  std::pmr::memory_resource* resource)
+            : node_(node), resource_(resource) {}
+
+        void reset() {
+            if (node_ != nullptr) {
+                destroy_node(std::exchange(node_, nullptr), resource_);
+            }
+        }
+
+        Node<T, Augment, Traits>* node_ = nullptr;
+        std::pmr::memory_resource* resource_ = nullptr;
 
         friend class Tree;
     };
 
+    // Результат вставки дескриптора, как у std::set::insert_return_type:
+    // при дубликате node возвращает дескриптор обратно.
+    struct insert_return_type {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+    // Курсор поиска, запоминающий последнюю найденную позицию и её ранг.
+    // Следующий поиск поднимается от этой позиции, пока искомый ключ не
+    // окажется внутри текущего поддерева, и спускается уже оттуда, так что
+    // близкие друг к другу запросы не проходят путь от корня. Подъём
+    // ограничен общим предком старой и новой позиций; для соседей по
+    // порядку это O(log d), где d — разница рангов. Любое изменение дерева
+    // делает курсор недействительным.
+    class Finger {
+    public:
+        explicit Finger(const Tree& tree) : owner_(&tree) {}
+
+        // lower_bound вместе с рангом найденной позиции.
+        ranked_iterator lower_bound(const key_type& value) {
+            return lower_bound<key_type>(value);
+        }
+
+        template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+        ranked_iterator lower_bound(const K& value) {
+            const auto& key = lookup_key(value);
+            return seek([this, &key](const key_type& candidate) {
+                return !owner_->less(candidate, key);
+            });
+        }
+
+        // upper_bound вместе с рангом найденной позиции.
+        ranked_iterator upper_bound(const key_type& value) {
+            return upper_bound<key_type>(value);
+        }
+
+        template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+        ranked_iterator upper_bound(const K& value) {
+            const auto& key = lookup_key(value);
+            return seek([this, &key](const key_type& candidate) {
+                return owner_->less(key, candidate);
+            });
+        }
+
+        // Последняя найденная позиция.
+        ranked_iterator position() const {
+            return ranked_iterator(iterator(owner_, current_), rank_);
+        }
+
+    private:
+        // Ищет первый узел, для которого found(ключ) истинно.
+        template <typename Found>
+        ranked_iterator seek(Found found) {
+            static_assert(is_counted,
+                          "rb::Tree rank queries require CountedNodes traits");
+            node_base* subtree = owner_->root_;
+            size_t start = 0;
+            node_base* fallback = nullptr;
+
+            if (current_ != nullptr) {
+                // Ответ правее current_, если сам он не подходит, иначе
+                // он в поддереве, содержащем current_.
+                const bool answer_after = !found(owner_->key_of(current_));
+                subtree = current_;
+                start = rank_ - owner_->node_size(current_->left_child());
+                while (subtree->parent() != nullptr) {
+                    node_base* parent = subtree->parent();
+                    const bool from_left = parent->left_child() == subtree;
+                    const bool parent_found = found(owner_->key_of(parent));
+                    if (answer_after && from_left && parent_found) {
+                        fallback = parent;
+                        break;
+                    }
+                    if (!answer_after && !from_left && !parent_found) {
+                        break;
+                    }
+                    if (!from_left) {
+                        start -= owner_->node_size(parent->left_child()) + 1;
+                    }
+                    subtree = parent;
+                }
+            }
+
+            // Без подходящего узла в поддереве ответ — fallback, стоящий
+            // сразу после поддерева.
+            const ranked_iterator result =
+                owner_->ranked_descent(subtree, start, fallback, found);
+            current_ = result.base_.current_;
+            rank_ = result.rank_;
+            return result;
+        }
+
+        const Tree* owner_;
+        node_base* current_ = nullptr;
+        size_t rank_ = 0;
+    };
+
+    // Курсор поиска по этому дереву.
+    Finger finger() const { return Finger(*this); }
+
     iterator begin() {
         return root_ ? iterator(this, minimum(root_)) : end();
     }
@@ -207,289 +561,907 @@ public:
 
     // Инициализирует пустое дерево.
     Tree()
-        : root_(nullptr) {}
+        : root_(nullptr), size_(0) {}
+
+    // Инициализирует пустое дерево с заданным компаратором.
+    explicit Tree(const Compare& compare)
+        : root_(nullptr), size_(0), compare_(compare) {}
+
+    // Пустое дерево, узлы которого выделяются из resource; nullptr —
+    // обычные new и delete. Ресурс должен пережить дерево.
+    explicit Tree(std::pmr::memory_resource* resource,
+                  const Compare& compare = Compare())
+        : root_(nullptr), size_(0), compare_(compare), resource_(resource) {}
+
+    // То же, но уничтожение, clear() и присваивание стоят O(1): узлы не
+    // обходятся, их память возвращается вместе с ресурсом. erase и extract
+    // по-прежнему отдают узлы ресурсу, так что пул может их переиспользовать.
+    Tree(std::pmr::memory_resource* resource,
+         release_nodes_with_resource_t,
+         const Compare& compare = Compare())
+        : root_(nullptr),
+          size_(0),
+          compare_(compare),
+          resource_(resource),
+          bulk_release_(true) {
+        static_assert(std::is_trivially_destructible_v<T> &&
+                          (std::is_void_v<summary_type> ||
+                           std::is_trivially_destructible_v<summary_type>),
+                      "release_nodes_with_resource skips destructors");
+        assert(resource != nullptr);
+    }
 
-    // Освобождает все узлы дерева.
+    // Освобождает все узлы дерева (в фоне, если назначен Reclaimer).
     ~Tree() {
-        clear(root_);
+        release(root_);
     }
 
-    // Выполняет глубокое копирование.
-    Tree(const Tree& other)
-        : root_(nullptr) {
+    // Выполняет глубокое копирование; копия, как и контейнеры std::pmr,
+    // не наследует ресурс памяти.
+    Tree(const Tree& other) : Tree(other, nullptr) {}
+
+    // Глубокая копия с узлами из resource.
+    Tree(const Tree& other, std::pmr::memory_resource* resource)
+        : root_(nullptr),
+          size_(other.size_),
+          compare_(other.compare_),
+          reclaimer_(other.reclaimer_),
+          resource_(resource) {
         root_ = clone_subtree(other.root_, nullptr);
     }
 
-    // Перемещает данные из другого дерева.
+    // Перемещает данные из другого дерева вместе с его ресурсом памяти.
     Tree(Tree&& other) noexcept
-        : root_(std::exchange(other.root_, nullptr)) {}
-
-    // Копирующее присваивание по идиоме copy-and-swap.
+        : root_(std::exchange(other.root_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          compare_(other.compare_),
+          reclaimer_(other.reclaimer_),
+          resource_(other.resource_),
+          bulk_release_(other.bulk_release_) {}
+
+    // Копирующее присваивание по идиоме copy-and-swap; ресурс памяти
+    // дерева не меняется.
     Tree& operator=(const Tree& other) {
         if (this == &other) {
             return *this;
         }
-        Tree tmp(other);
-        *this = std::move(tmp);
+        *this = Tree(other, resource_);
         return *this;
     }
 
-    // Перемещающее присваивание.
-    Tree& operator=(Tree&& other) noexcept {
+    // Перемещающее присваивание. Узлы забираются, только если у деревьев
+    // общий ресурс памяти, иначе копируются в свой.
+    Tree& operator=(Tree&& other) {
         if (this != &other) {
-            Tree temp(std::move(other));
+            Tree temp = other.resource_ == resource_
+                            ? Tree(std::move(other))
+                            : Tree(other, resource_);
             std::swap(root_, temp.root_);
+            std::swap(size_, temp.size_);
+            std::swap(compare_, temp.compare_);
+            // Старые узлы освобождаются так, как настроено это дерево.
+            temp.reclaimer_ = reclaimer_;
+            temp.bulk_release_ = bulk_release_;
         }
         return *this;
     }
 
+    // Назначает фоновый поток, которому дерево отдаёт узлы при
+    // уничтожении, очистке и присваивании; nullptr — освобождать на месте.
+    // Действует только для узлов из обычной кучи: с ресурсом pmr узлы
+    // освобождаются на месте.
+    void set_reclaimer(Reclaimer* reclaimer) { reclaimer_ = reclaimer; }
+    Reclaimer* reclaimer() const { return reclaimer_; }
+
+    // Ресурс, из которого выделяются узлы; nullptr — new и delete.
+    std::pmr::memory_resource* memory_resource() const { return resource_; }
+
+    // Удаляет все элементы; с Reclaimer вызывающий поток тратит O(1).
+    void clear() {
+        node_base* root = std::exchange(root_, nullptr);
+        size_ = 0;
+        release(root);
+    }
+
     // Проверяет, пусто ли дерево.
     bool empty() const { return root_ == nullptr; }
 
     // Вставляет значение, поддерживая баланс и статистики; false при дубликате.
     bool insert(const T& value) {
-        auto result = locate(value);
-        if (result.exists) {
-            return false;
-        }
+        return insert_unique(value).second;
+    }
 
-        auto* parent = result.parent;
-        auto* new_node = make_node(value,
-                                   NodeBase<T>::Color::RED,
-                                   nullptr,
-                                   nullptr,
-                                   parent);
+    // Перегрузка для перемещающей вставки.
+    bool insert(T&& value) {
+        return insert_unique(std::move(value)).second;
+    }
 
-        if (parent == nullptr) {
-            root_ = new_node;
-        } else if (result.go_left) {
-            parent->set_left_child(new_node);
-        } else {
-            parent->set_right_child(new_node);
+    // Удаляет значение, восстанавливая баланс; возвращает false, если узла нет.
+    bool erase(const key_type& value) {
+        return erase<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    bool erase(const K& value) {
+        auto result = locate(lookup_key(value));
+        if (!result.exists) {
+            return false;
         }
 
-        fix_insert_root(new_node);
-        update_size_upwards(new_node);
+        node_base* z = result.parent;
+        unlink(z);
+        destroy_node(z, resource_);
         return true;
     }
 
-    // Удаляет значение, восстанавливая баланс; возвращает false, если узла нет.
-    bool erase(const T& value) {
-        auto result = locate(value);
+    // Передаёт modifier изменяемое значение с ключом key и пересчитывает
+    // сводки от узла до корня за O(log n) без удаления и вставки; modifier
+    // не должен менять ключ. false, если ключа нет.
+    template <typename Modifier>
+    bool modify(const key_type& key, Modifier&& modifier) {
+        return modify<key_type>(key, std::forward<Modifier>(modifier));
+    }
+
+    template <typename K, typename Modifier, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    bool modify(const K& key, Modifier&& modifier) {
+        auto result = locate(lookup_key(key));
         if (!result.exists) {
             return false;
         }
+        std::forward<Modifier>(modifier)(as_node(result.parent)->value());
+        assert(compare3(lookup_key(key), key_of(result.parent)) == 0);
+        update_upwards(result.parent);
+        return true;
+    }
 
-        NodeBase<T>* z = result.parent;
-        DetachResult detach = detach_node(z);
-        delete z;
+    // Извлекает узел с ключом value; пустой дескриптор, если ключа нет.
+    node_type extract(const key_type& value) {
+        return extract<key_type>(value);
+    }
 
-        if (detach.removed_color == node_color::BLACK) {
-            erase_fixup(detach.fixup, detach.parent);
-        }
-        return true;
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    node_type extract(const K& value) {
+        auto result = locate(lookup_key(value));
+        return result.exists ? extract_node(result.parent) : node_type();
     }
 
-    // Проверяет соблюдение инвариантов красно-чёрного дерева.
-    bool is_valid() const {
-        const NodeBase<T>* root = root_;
+    // Извлекает узел, на который указывает position (не end()).
+    node_type extract(iterator position) {
+        assert(position.owner_ == this && position.current_ != nullptr);
+        return extract_node(position.current_);
+    }
 
-        if (root == nullptr) {
-            return true;
+    // Вставляет извлечённый узел без выделения памяти, если ресурсы
+    // деревьев совпадают; иначе значение переносится в новый узел.
+    insert_return_type insert(node_type&& handle) {
+        if (handle.empty()) {
+            return {end(), false, node_type()};
         }
+        auto result = locate(KeyOf{}(handle.value()));
+        if (result.exists) {
+            return {iterator(this, result.parent), false, std::move(handle)};
+        }
+        node_base* node = link_handle(std::move(handle), result);
+        return {iterator(this, node), true, node_type()};
+    }
 
-        if (root->color() != NodeBase<T>::Color::BLACK) {
-            return false;
+    // Переносит в дерево узлы source, ключей которых здесь нет, как
+    // std::set::merge; остальные остаются в source. На каждый узел —
+    // один спуск по этому дереву, найденное место сразу идёт в link_node.
+    void merge(Tree& source) {
+        if (&source == this) {
+            return;
+        }
+        for (auto it = source.begin(); it != source.end();) {
+            const auto current = it++;
+            const auto result = locate(KeyOf{}(*current));
+            if (!result.exists) {
+                link_handle(source.extract(current), result);
+            }
         }
+    }
 
-        int black_height = 0;
-        return validate_subtree(root, &black_height);
+    void merge(Tree&& source) {
+        merge(source);
     }
 
-    size_t distance(const T& first, const T& second) const {
-        if (first > second) { 
-            return 0;
+    // Проверяет инварианты дерева: цвета, чёрные высоты, порядок ключей,
+    // ссылки на родителей, размеры поддеревьев и сводки. Обход
+    // итеративный, поэтому глубина дерева не ограничена стеком.
+    bool is_valid() const {
+        return validate_tree(1);
+    }
+
+    // То же на threads потоках (0 — по числу ядер): поддеревья верхних
+    // уровней проверяются параллельно, затем сверяются с вершиной.
+    bool is_valid(unsigned threads) const {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
         }
+        return validate_tree(threads);
+    }
 
-        size_t first_rank = rank_comp_bound(first, *compare_lower_bound<T>);
-        size_t second_rank = rank_comp_bound(second, *compare_upper_bound<T>);
+    size_t distance(const key_type& first, const key_type& second) const {
+        return distance<key_type>(first, second);
+    }
 
-        assert(first_rank <= second_rank);
-        return second_rank - first_rank;
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    size_t distance(const K& first, const K& second) const {
+        return distance_keys(lookup_key(first), lookup_key(second));
     }
 
     // Возвращает позицию элемента в упорядоченном обходе.
-    size_t distance_from_root(const T& value) const {
-        auto location = locate(value);
+    size_t distance_from_root(const key_type& value) const {
+        return distance_from_root<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    size_t distance_from_root(const K& value) const {
+        auto location = locate(lookup_key(value));
         if (!location.exists) {
             return std::numeric_limits<size_t>::max();
         }
-        return rank_comp_bound(value, compare_lower_bound<T>);
+        return order_statistics(location.parent);
+    }
+
+    // Количество ключей, строго меньших заданного.
+    size_t rank(const key_type& value) const {
+        return rank<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    size_t rank(const K& value) const {
+        return rank_less(lookup_key(value));
     }
 
     // Количество элементов в дереве.
-    size_t size() const { return node_size(root_); }
+    size_t size() const { return size_; }
 
-    iterator lower_bound(const T& value) const {
-        return iterator(this, lower_bound_node(value));
+    iterator find(const key_type& value) const {
+        return find<key_type>(value);
     }
 
-    iterator upper_bound(const T& value) const {
-        return iterator(this, upper_bound_node(value));
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    iterator find(const K& value) const {
+        auto location = locate(lookup_key(value));
+        return iterator(this, location.exists ? location.parent : nullptr);
     }
 
-    using cmp_t = std::function<bool(const T&, const T&)>; 
-    size_t rank_comp_bound(const T& value, cmp_t cmp) const {;
-        const NodeBase<T>* current = root_;
-        size_t result = 0;
+    bool contains(const key_type& value) const {
+        return contains<key_type>(value);
+    }
 
-        while (!is_nil(current)) {
-            const T& current_value = as_node(current)->value();
-            if (cmp(current_value, value)) {
-                result += node_size(current->left_child()) + 1;
-                current = current->right_child();
-            } else {
-                current = current->left_child();
-            }
-        }
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    bool contains(const K& value) const {
+        return locate(lookup_key(value)).exists;
+    }
 
-        return result;
+    // Возвращает итератор на k-й по возрастанию элемент (с нуля) или end().
+    iterator select(size_t k) const {
+        return iterator(this, select_node(k));
+    }
+
+    iterator lower_bound(const key_type& value) const {
+        return lower_bound<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    iterator lower_bound(const K& value) const {
+        return iterator(this, lower_bound_node(lookup_key(value)));
+    }
+
+    iterator upper_bound(const key_type& value) const {
+        return upper_bound<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    iterator upper_bound(const K& value) const {
+        return iterator(this, upper_bound_node(lookup_key(value)));
+    }
+
+    // lower_bound и upper_bound, запоминающие ранг найденной позиции.
+    ranked_iterator ranked_lower_bound(const key_type& value) const {
+        return ranked_lower_bound<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    ranked_iterator ranked_lower_bound(const K& value) const {
+        const auto& key = lookup_key(value);
+        return ranked_descent(root_, 0, nullptr,
+                              [this, &key](const key_type& candidate) {
+                                  return !less(candidate, key);
+                              });
+    }
+
+    ranked_iterator ranked_upper_bound(const key_type& value) const {
+        return ranked_upper_bound<key_type>(value);
+    }
+
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    ranked_iterator ranked_upper_bound(const K& value) const {
+        const auto& key = lookup_key(value);
+        return ranked_descent(root_, 0, nullptr,
+                              [this, &key](const key_type& candidate) {
+                                  return less(key, candidate);
+                              });
+    }
+
+    ranked_iterator ranked_begin() const { return ranked_iterator(begin(), 0); }
+    ranked_iterator ranked_end() const { return ranked_iterator(end(), size_); }
+
+    // k-й элемент вместе с рангом k; ranked_end() вне диапазона.
+    ranked_iterator ranked_select(size_t k) const {
+        return k < size_ ? ranked_iterator(select(k), k) : ranked_end();
+    }
+
+    using cmp_t = std::function<bool(const key_type&, const key_type&)>;
+    size_t rank_comp_bound(const key_type& value, cmp_t cmp) const {
+        return rank_by(value, cmp);
+    }
+
+    // Пакетные запросы. Спуски независимых ключей чередуются группами по
+    // batch_group: шаг одного спуска разбирает узел, загруженный заранее,
+    // запрашивает prefetch следующего и уступает очередь соседу, так что
+    // промахи кэша разных спусков обслуживаются одновременно. Выигрыш
+    // заметен на деревьях, не помещающихся в кэш последнего уровня.
+    static constexpr std::size_t batch_group = 16;
+
+    // rank для каждого ключа; результаты в порядке ключей.
+    template <typename K>
+    std::vector<size_t> rank_batch(const std::vector<K>& keys) const {
+        return rank_batch_keys(lookup_keys(keys));
+    }
+
+    // distance для каждой пары [first, second].
+    template <typename K>
+    std::vector<size_t> distance_batch(
+        const std::vector<std::pair<K, K>>& ranges) const {
+        return distance_batch_keys(lookup_ranges(ranges));
+    }
+
+    // lower_bound для каждого ключа.
+    template <typename K>
+    std::vector<iterator> lower_bound_batch(const std::vector<K>& keys) const {
+        return lower_bound_batch_keys(lookup_keys(keys));
+    }
+
+    // Сводка всего дерева.
+    summary_type aggregate() const {
+        static_assert(has_augment,
+                      "rb::Tree<T>::aggregate requires an augmentation policy");
+        return summary_of(root_);
+    }
+
+    // Сворачивает значения из отрезка [left, right] за O(log n).
+    summary_type aggregate(const key_type& left, const key_type& right) const {
+        return aggregate<key_type>(left, right);
     }
 
+    template <typename K, detail::enable_lookup_t<Compare, key_type, K> = 0>
+    summary_type aggregate(const K& left, const K& right) const {
+        static_assert(has_augment,
+                      "rb::Tree<T>::aggregate requires an augmentation policy");
+        return aggregate_keys(lookup_key(left), lookup_key(right));
+    }
+
+    // Строит дерево из неотсортированного диапазона на threads потоках
+    // (0 — по числу ядер): параллельная сортировка (поразрядная для целых
+    // ключей), удаление дубликатов и сбалансированная сборка, в которой
+    // верхние поддеревья выделяются и связываются на отдельных потоках.
+    // Какой из равных ключей останется, не определено.
+    template <typename InputIt>
+    static Tree from_unsorted(InputIt first,
+                              InputIt last,
+                              unsigned threads = 0,
+                              const Compare& compare = Compare()) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        std::vector<T> values(first, last);
+        const auto value_less = [&compare](const T& lhs, const T& rhs) {
+            return compare(KeyOf{}(lhs), KeyOf{}(rhs));
+        };
+        constexpr bool use_radix = detail::radix_sortable_v<T> &&
+                                   std::is_same_v<KeyOf, IdentityKey> &&
+                                   (std::is_same_v<Compare, ThreeWayLess> ||
+                                    std::is_same_v<Compare, KeyLess<T>>);
+        detail::parallel_sort<use_radix>(values, threads, value_less);
+        values.erase(std::unique(values.begin(),
+                                 values.end(),
+                                 [&value_less](const T& lhs, const T& rhs) {
+                                     return !value_less(lhs, rhs);
+                                 }),
+                     values.end());
+
+        Tree tree(compare);
+        tree.build_balanced(values, threads);
+        return tree;
+    }
 
 private:
+    template <typename, typename, typename>
+    friend class Map;
+    template <typename>
+    friend class IntervalTree;
+
     // Вспомогательная структура для locate.
     struct LocateResult {
-        NodeBase<T>* parent;
+        node_base* parent;
         bool exists;
         bool go_left;
     };
 
-    NodeBase<T>* root_;
+    node_base* root_;
+    std::size_t size_;
+    Compare compare_;
+    Reclaimer* reclaimer_ = nullptr;
+    std::pmr::memory_resource* resource_ = nullptr;
+    // Узлы не обходятся при освобождении, см. release_nodes_with_resource.
+    bool bulk_release_ = false;
+
+    using node_t = Node<T, Augment, Traits>;
+    using node_color = typename node_base::Color;
 
-    using node_color = typename NodeBase<T>::Color;
+    static constexpr bool has_augment = has_augment_v<Augment>;
+    static constexpr bool is_counted = Traits::counted;
+    // Нужно ли пересчитывать узлы при изменении их детей.
+    static constexpr bool maintains_nodes = is_counted || has_augment;
 
     struct DetachResult {
-        NodeBase<T>* fixup;
-        NodeBase<T>* parent;
+        node_base* fixup;
+        node_base* parent;
         node_color removed_color;
     };
 
-    bool is_nil(const NodeBase<T>* node) const { return node == nullptr; }
+    // Передаёт ключ поиска как есть для прозрачного компаратора,
+    // иначе приводит его к key_type.
+    template <typename K>
+    static decltype(auto) lookup_key(const K& value) {
+        return detail::lookup_key<key_type, Compare>(value);
+    }
+
+    template <typename L, typename R>
+    bool less(const L& lhs, const R& rhs) const {
+        return compare_(lhs, rhs);
+    }
+
+    // Трёхстороннее сравнение: знак результата как у strcmp.
+    template <typename L, typename R>
+    auto compare3(const L& lhs, const R& rhs) const {
+        return detail::three_way(compare_, lhs, rhs);
+    }
+
+    template <typename K>
+    size_t distance_keys(const K& first, const K& second) const {
+        if (less(second, first)) {
+            return 0;
+        }
+
+        size_t first_rank = rank_less(first);
+        size_t second_rank = rank_by(second, [this](const key_type& current,
+                                                    const K& target) {
+            return !less(target, current);
+        });
+
+        assert(first_rank <= second_rank);
+        return second_rank - first_rank;
+    }
+
+    template <typename K>
+    size_t rank_less(const K& value) const {
+        return rank_by(value, [this](const key_type& current, const K& target) {
+            return less(current, target);
+        });
+    }
+
+    template <typename K>
+    summary_type aggregate_keys(const K& left, const K& right) const {
+        if (less(right, left)) {
+            return Augment::identity();
+        }
+
+        // Ищем верхний узел, попадающий в отрезок: ниже него границы расходятся.
+        const node_base* split = root_;
+        while (!is_nil(split)) {
+            const key_type& split_value = key_of(split);
+            if (less(split_value, left)) {
+                split = split->right_child();
+            } else if (less(right, split_value)) {
+                split = split->left_child();
+            } else {
+                break;
+            }
+        }
+        if (is_nil(split)) {
+            return Augment::identity();
+        }
+
+        summary_type left_part = Augment::identity();
+        for (const node_base* current = split->left_child();
+             !is_nil(current);) {
+            if (less(key_of(current), left)) {
+                current = current->right_child();
+            } else {
+                left_part = Augment::combine(
+                    Augment::combine(Augment::lift(as_node(current)->value()),
+                                     summary_of(current->right_child())),
+                    left_part);
+                current = current->left_child();
+            }
+        }
+
+        summary_type right_part = Augment::identity();
+        for (const node_base* current = split->right_child();
+             !is_nil(current);) {
+            if (less(right, key_of(current))) {
+                current = current->left_child();
+            } else {
+                right_part = Augment::combine(
+                    right_part,
+                    Augment::combine(summary_of(current->left_child()),
+                                     Augment::lift(as_node(current)->value())));
+                current = current->right_child();
+            }
+        }
 
-    // Приводит базовый указатель к типу Node<T>.
-    Node<T>* as_node(NodeBase<T>* node) {
-        return static_cast<Node<T>*>(node);
+        return Augment::combine(
+            Augment::combine(left_part,
+                             Augment::lift(as_node(split)->value())),
+            right_part);
     }
 
-    // Приводит базовый указатель к константному типу Node<T>.
-    const Node<T>* as_node(const NodeBase<T>* node) const {
-        return static_cast<const Node<T>*>(node);
+    bool is_nil(const node_base* node) const { return node == nullptr; }
+
+    // Приводит базовый указатель к типу узла.
+    node_t* as_node(node_base* node) {
+        return static_cast<node_t*>(node);
+    }
+
+    // Приводит базовый указатель к константному типу узла.
+    const node_t* as_node(const node_base* node) const {
+        return static_cast<const node_t*>(node);
+    }
+
+    // Возвращает ключ, по которому упорядочен узел.
+    const key_type& key_of(const node_base* node) const {
+        return KeyOf{}(as_node(node)->value());
     }
 
     // Возвращает цвет узла, считая nullptr чёрным.
-    node_color color_of(const NodeBase<T>* node) const {
-        return is_nil(node) ? NodeBase<T>::Color::BLACK : node->color();
+    node_color color_of(const node_base* node) const {
+        return is_nil(node) ? node_base::Color::BLACK : node->color();
     }
 
-    node_color color_of(NodeBase<T>* node) const {
-        return color_of(static_cast<const NodeBase<T>*>(node));
+    node_color color_of(node_base* node) const {
+        return color_of(static_cast<const node_base*>(node));
     }
 
-    bool is_black(const NodeBase<T>* node) const {
+    bool is_black(const node_base* node) const {
         return color_of(node) == node_color::BLACK;
     }
 
-    bool is_red(const NodeBase<T>* node) const {
+    bool is_red(const node_base* node) const {
         return color_of(node) == node_color::RED;
     }
 
     // Возвращает количество элементов в поддереве узла; 0 для nullptr.
-    std::size_t node_size(const NodeBase<T>* node) const {
+    std::size_t node_size(const node_base* node) const {
+        static_assert(is_counted,
+                      "rb::Tree rank queries require CountedNodes traits");
         return is_nil(node) ? 0 : node->subtree_size();
     }
 
-    // Пересчитывает размер поддерева на основе детей.
-    void recalc_size(NodeBase<T>* node) {
+    // Возвращает сводку поддерева узла; нейтральный элемент для nullptr.
+    summary_type summary_of(const node_base* node) const {
+        return is_nil(node) ? Augment::identity() : as_node(node)->summary();
+    }
+
+    // Пересчитывает размер и сводку поддерева на основе детей.
+    void recalc_node(node_base* node) {
         if (is_nil(node)) {
             return;
         }
-        const std::size_t left = node_size(node->left_child());
-        const std::size_t right = node_size(node->right_child());
-        node->set_subtree_size(left + right + 1);
+        if constexpr (is_counted) {
+            const std::size_t left = node_size(node->left_child());
+            const std::size_t right = node_size(node->right_child());
+            node->set_subtree_size(
+                static_cast<typename Traits::size_type>(left + right + 1));
+        }
+
+        if constexpr (has_augment) {
+            node_t* current = as_node(node);
+            current->set_summary(Augment::combine(
+                Augment::combine(summary_of(node->left_child()),
+                                 Augment::lift(current->value())),
+                summary_of(node->right_child())));
+        }
     }
 
-    // Поддерживает размеры всех предков узла актуальными.
-    void update_size_upwards(NodeBase<T>* node) {
+    // Поддерживает размеры и сводки всех предков узла актуальными.
+    void update_upwards(node_base* node) {
+        if constexpr (!maintains_nodes) {
+            return;
+        }
         while (!is_nil(node)) {
-            recalc_size(node);
+            recalc_node(node);
             node = node->parent();
         }
     }
 
     // Создаёт узел, заполняя указанные ссылки на детей и родителя.
-    Node<T>* make_node(const T& value,
-                       node_color color,
-                       NodeBase<T>* left,
-                       NodeBase<T>* right,
-                       NodeBase<T>* parent) {
-        auto* node = new Node<T>(value, color, left, right, parent);
-        recalc_size(node);
+    node_t* make_node(const T& value,
+                      node_color color,
+                      node_base* left,
+                      node_base* right,
+                      node_base* parent) {
+        auto* node = allocate_node(value, color, left, right, parent);
+        recalc_node(node);
         return node;
     }
 
     // Перегрузка для перемещающего создания узла.
-    Node<T>* make_node(T&& value,
-                       node_color color,
-                       NodeBase<T>* left,
-                       NodeBase<T>* right,
-                       NodeBase<T>* parent) {
-        auto* node =
-            new Node<T>(std::move(value), color, left, right, parent);
-        recalc_size(node);
+    node_t* make_node(T&& value,
+                      node_color color,
+                      node_base* left,
+                      node_base* right,
+                      node_base* parent) {
+        auto* node = allocate_node(std::move(value), color, left, right, parent);
+        recalc_node(node);
+        return node;
+    }
+
+    template <typename U>
+    node_t* allocate_node(U&& value,
+                          node_color color,
+                          node_base* left,
+                          node_base* right,
+                          node_base* parent) {
+        if (resource_ == nullptr) {
+            return new node_t(std::forward<U>(value), color, left, right, parent);
+        }
+        void* memory = resource_->allocate(sizeof(node_t), alignof(node_t));
+        try {
+            return new (memory)
+                node_t(std::forward<U>(value), color, left, right, parent);
+        } catch (...) {
+            resource_->deallocate(memory, sizeof(node_t), alignof(node_t));
+            throw;
+        }
+    }
+
+    static void destroy_node(node_base* node, std::pmr::memory_resource* resource) {
+        if (resource == nullptr) {
+            delete node;
+            return;
+        }
+        node->~node_base();
+        resource->deallocate(node, sizeof(node_t), alignof(node_t));
+    }
+
+    // Строит идеально сбалансированное дерево из отсортированных values без
+    // дубликатов. Все уровни, кроме последнего, заполнены; последний красный,
+    // поэтому чёрная высота всех путей одинакова.
+    void build_balanced(std::vector<T>& values, unsigned threads) {
+        assert(root_ == nullptr);
+        if (values.empty()) {
+            return;
+        }
+        if constexpr (is_counted) {
+            assert(values.size() <=
+                   std::numeric_limits<typename Traits::size_type>::max());
+        }
+
+        int red_depth = 0;
+        while ((std::size_t{2} << red_depth) <= values.size()) {
+            ++red_depth;
+        }
+        int spawn_depth = 0;
+        while ((1u << spawn_depth) < threads) {
+            ++spawn_depth;
+        }
+
+        root_ = build_range(values.data(), 0, values.size(), 0, red_depth,
+                            spawn_depth);
+        root_->set_color(node_color::BLACK);
+        size_ = values.size();
+    }
+
+    node_base* build_range(T* values,
+                           std::size_t low,
+                           std::size_t high,
+                           int depth,
+                           int red_depth,
+                           int spawn_depth) {
+        if (low >= high) {
+            return nullptr;
+        }
+
+        const std::size_t middle = low + (high - low) / 2;
+        node_base* left = nullptr;
+        node_base* right = nullptr;
+        node_base* node = nullptr;
+        // Если выделение или перенос значения бросит исключение (в том числе
+        // на потоке для левой половины), поток всё равно присоединяется, а
+        // уже построенные поддеревья освобождаются.
+        try {
+            if (depth < spawn_depth) {
+                std::exception_ptr left_error;
+                std::thread worker([&] {
+                    try {
+                        left = build_range(values, low, middle, depth + 1,
+                                           red_depth, spawn_depth);
+                    } catch (...) {
+                        left_error = std::current_exception();
+                    }
+                });
+                try {
+                    right = build_range(values, middle + 1, high, depth + 1,
+                                        red_depth, spawn_depth);
+                } catch (...) {
+                    worker.join();
+                    throw;
+                }
+                worker.join();
+                if (left_error) {
+                    std::rethrow_exception(left_error);
+                }
+            } else {
+                left = build_range(values, low, middle, depth + 1, red_depth,
+                                   spawn_depth);
+                right = build_range(values, middle + 1, high, depth + 1,
+                                    red_depth, spawn_depth);
+            }
+
+            const node_color color =
+                depth == red_depth ? node_color::RED : node_color::BLACK;
+            node = make_node(std::move(values[middle]), color, left, right,
+                             nullptr);
+        } catch (...) {
+            clear(left, resource_);
+            clear(right, resource_);
+            throw;
+        }
+        if (left != nullptr) {
+            left->set_parent(node);
+        }
+        if (right != nullptr) {
+            right->set_parent(node);
+        }
         return node;
     }
 
+    // Освобождает поддерево на месте или передаёт его Reclaimer. В фон
+    // уходят только узлы из обычной кучи: ресурс pmr не синхронизирован и
+    // может быть уничтожен раньше, чем задача выполнится.
+    void release(node_base* root) {
+        if (root == nullptr || bulk_release_) {
+            return;
+        }
+        if (reclaimer_ != nullptr && resource_ == nullptr) {
+            reclaimer_->defer([root] { clear(root, nullptr); });
+        } else {
+            clear(root, resource_);
+        }
+    }
+
     // Очищает поддерево, освобождая все узлы.
-    void clear(NodeBase<T>* node) {
+    static void clear(node_base* node, std::pmr::memory_resource* resource) {
         if (node == nullptr) {
             return;
         }
 
-        std::vector<NodeBase<T>*> stack;
+        std::vector<node_base*> stack;
         stack.push_back(node);
 
         while (!stack.empty()) {
-            NodeBase<T>* current = stack.back();
+            node_base* current = stack.back();
             stack.pop_back();
 
-            NodeBase<T>* left = current->left_child();
+            node_base* left = current->left_child();
             if (left != nullptr) {
                 stack.push_back(left);
             }
 
-            NodeBase<T>* right = current->right_child();
+            node_base* right = current->right_child();
             if (right != nullptr) {
                 stack.push_back(right);
             }
 
-            delete current; 
+            destroy_node(current, resource);
+        }
+    }
+
+    // Вставляет значение; возвращает узел с этим ключом и признак вставки.
+    template <typename U>
+    std::pair<node_base*, bool> insert_unique(U&& value) {
+        auto result = locate(KeyOf{}(value));
+        if (result.exists) {
+            return {result.parent, false};
+        }
+        return {insert_at(std::forward<U>(value), result), true};
+    }
+
+    // Создаёт узел со значением value в месте, найденном locate, без
+    // повторного спуска.
+    template <typename U>
+    node_base* insert_at(U&& value, const LocateResult& result) {
+        auto* new_node = make_node(std::forward<U>(value),
+                                   node_base::Color::RED,
+                                   nullptr,
+                                   nullptr,
+                                   nullptr);
+        return link_node(new_node, result);
+    }
+
+    // Подвешивает красный лист node в место, найденное locate, и
+    // восстанавливает баланс.
+    node_base* link_node(node_base* node, const LocateResult& result) {
+        if constexpr (is_counted) {
+            assert(size_ < std::numeric_limits<
+                               typename Traits::size_type>::max());
+        }
+        node_base* parent = result.parent;
+        node->set_parent(parent);
+        if (parent == nullptr) {
+            root_ = node;
+        } else if (result.go_left) {
+            parent->set_left_child(node);
+        } else {
+            parent->set_right_child(node);
+        }
+
+        fix_insert_root(node);
+        update_upwards(node);
+        ++size_;
+        return node;
+    }
+
+    // Вынимает узел из дерева с восстановлением баланса, не освобождая его.
+    void unlink(node_base* z) {
+        DetachResult detach = detach_node(z);
+        --size_;
+        if (detach.removed_color == node_color::BLACK) {
+            erase_fixup(detach.fixup, detach.parent);
         }
     }
 
+    // Подвешивает узел из непустого дескриптора в место result; узел из
+    // чужого ресурса заменяется новым с перенесённым значением.
+    node_base* link_handle(node_type&& handle, const LocateResult& result) {
+        if (handle.resource_ != resource_) {
+            node_base* node = insert_at(std::move(handle.value()), result);
+            handle.reset();
+            return node;
+        }
+
+        node_t* node = std::exchange(handle.node_, nullptr);
+        node->set_left_child(nullptr);
+        node->set_right_child(nullptr);
+        node->set_color(node_color::RED);
+        recalc_node(node);
+        return link_node(node, result);
+    }
+
+    node_type extract_node(node_base* z) {
+        unlink(z);
+        return node_type(as_node(z), resource_);
+    }
+
     // Находит место вставки или существующий узел.
-    LocateResult locate(const T& value) const {
-        NodeBase<T>* current = root_;
-        NodeBase<T>* parent = nullptr;
+    template <typename K>
+    LocateResult locate(const K& value) const {
+        node_base* current = root_;
+        node_base* parent = nullptr;
         bool go_left = false;
 
         while (current != nullptr) {
             parent = current;
-            const T& current_value = as_node(current)->value();
-            if (value < current_value) {
+            const auto order = compare3(value, key_of(current));
+            if (order < 0) {
                 current = current->left_child();
                 go_left = true;
-            } else if (current_value < value) {
+            } else if (order > 0) {
                 current = current->right_child();
                 go_left = false;
             } else {
@@ -501,12 +1473,12 @@ private:
     }
 
     // Выполняет поворот вокруг узла в указанном направлении.
-    void rotate(NodeBase<T>* node, Direction dir) {
-        NodeBase<T>* pivot =
+    void rotate(node_base* node, Direction dir) {
+        node_base* pivot =
             (dir == Direction::LEFT) ? node->right_child() : node->left_child();
         assert(!is_nil(pivot));
 
-        NodeBase<T>* pivot_parent = node->parent();
+        node_base* pivot_parent = node->parent();
         if (pivot_parent == nullptr) {
             root_ = pivot;
             pivot->set_parent(nullptr);
@@ -534,28 +1506,28 @@ private:
         }
 
         node->set_parent(pivot);
-        recalc_size(node);
-        recalc_size(pivot);
-        update_size_upwards(pivot_parent);
+        // Содержимое поддерева pivot_parent не меняется, предков не трогаем.
+        recalc_node(node);
+        recalc_node(pivot);
     }
 
-    void rotate_left(NodeBase<T>* node) {
+    void rotate_left(node_base* node) {
         rotate(node, Direction::LEFT);
     }
 
-    void rotate_right(NodeBase<T>* node) {
+    void rotate_right(node_base* node) {
         rotate(node, Direction::RIGHT);
     }
 
     // Возвращает деда для текущего узла.
-    NodeBase<T>* grandparent(NodeBase<T>* node) const {
-        NodeBase<T>* parent = node->parent();
+    node_base* grandparent(node_base* node) const {
+        node_base* parent = node->parent();
         return parent == nullptr ? nullptr : parent->parent();
     }
 
     // Возвращает дядю текущего узла.
-    NodeBase<T>* uncle(NodeBase<T>* node) const {
-        NodeBase<T>* grand = grandparent(node);
+    node_base* uncle(node_base* node) const {
+        node_base* grand = grandparent(node);
         if (grand == nullptr) {
             return nullptr;
         }
@@ -567,9 +1539,9 @@ private:
     }
 
     // Обрабатывает случай вставки корневого узла.
-    void fix_insert_root(NodeBase<T>* node) {
+    void fix_insert_root(node_base* node) {
         if (node->parent() == nullptr) {
-            node->set_color(NodeBase<T>::Color::BLACK);
+            node->set_color(node_base::Color::BLACK);
             root_ = node;
             return;
         }
@@ -577,23 +1549,23 @@ private:
     }
 
     // Обрабатывает случай чёрного родителя.
-    void fix_insert_black_parent(NodeBase<T>* node) {
-        NodeBase<T>* parent = node->parent();
-        if (parent == nullptr || parent->color() == NodeBase<T>::Color::BLACK) {
+    void fix_insert_black_parent(node_base* node) {
+        node_base* parent = node->parent();
+        if (parent == nullptr || parent->color() == node_base::Color::BLACK) {
             return;
         }
         fix_insert_red_uncle(node);
     }
 
     // Обрабатывает случай красного дяди.
-    void fix_insert_red_uncle(NodeBase<T>* node) {
-        NodeBase<T>* u = uncle(node);
-        if (u != nullptr && u->color() == NodeBase<T>::Color::RED) {
-            node->parent()->set_color(NodeBase<T>::Color::BLACK);
-            u->set_color(NodeBase<T>::Color::BLACK);
-            NodeBase<T>* g = grandparent(node);
+    void fix_insert_red_uncle(node_base* node) {
+        node_base* u = uncle(node);
+        if (u != nullptr && u->color() == node_base::Color::RED) {
+            node->parent()->set_color(node_base::Color::BLACK);
+            u->set_color(node_base::Color::BLACK);
+            node_base* g = grandparent(node);
             if (g != nullptr) {
-                g->set_color(NodeBase<T>::Color::RED);
+                g->set_color(node_base::Color::RED);
                 fix_insert_root(g);
             }
         } else {
@@ -602,9 +1574,9 @@ private:
     }
 
     // Выполняет промежуточные повороты.
-    void fix_insert_inner_child(NodeBase<T>* node) {
-        NodeBase<T>* parent = node->parent();
-        NodeBase<T>* grand = grandparent(node);
+    void fix_insert_inner_child(node_base* node) {
+        node_base* parent = node->parent();
+        node_base* grand = grandparent(node);
         if (grand == nullptr || parent == nullptr) {
             return;
         }
@@ -622,15 +1594,15 @@ private:
     }
 
     // Завершает восстановление баланса после вставки.
-    void finalize_insert_rebalance(NodeBase<T>* node) {
-        NodeBase<T>* parent = node->parent();
-        NodeBase<T>* grand = grandparent(node);
+    void finalize_insert_rebalance(node_base* node) {
+        node_base* parent = node->parent();
+        node_base* grand = grandparent(node);
         if (parent == nullptr || grand == nullptr) {
             return;
         }
 
-        parent->set_color(NodeBase<T>::Color::BLACK);
-        grand->set_color(NodeBase<T>::Color::RED);
+        parent->set_color(node_base::Color::BLACK);
+        grand->set_color(node_base::Color::RED);
 
         if (node == parent->left_child() && parent == grand->left_child()) {
             rotate_right(grand);
@@ -641,7 +1613,7 @@ private:
     }
 
     // Возвращает минимальный узел в поддереве.
-    NodeBase<T>* minimum(NodeBase<T>* node) const {
+    node_base* minimum(node_base* node) const {
         while (node != nullptr && node->left_child() != nullptr) {
             node = node->left_child();
         }
@@ -649,7 +1621,7 @@ private:
     }
 
     // Возвращает максимальный узел в поддереве.
-    NodeBase<T>* maximum(NodeBase<T>* node) const {
+    node_base* maximum(node_base* node) const {
         while (node != nullptr && node->right_child() != nullptr) {
             node = node->right_child();
         }
@@ -657,14 +1629,14 @@ private:
     }
 
     // Возвращает следующий узел.
-    NodeBase<T>* next(NodeBase<T>* node) const {
+    node_base* next(node_base* node) const {
         if (node == nullptr) {
             return nullptr;
         }
         if (node->right_child() != nullptr) {
             return minimum(node->right_child());
         }
-        NodeBase<T>* parent = node->parent();
+        node_base* parent = node->parent();
         while (parent != nullptr && node == parent->right_child()) {
             node = parent;
             parent = parent->parent();
@@ -673,14 +1645,14 @@ private:
     }
 
     // Возвращает предыдущий узел.
-    NodeBase<T>* prev(NodeBase<T>* node) const {
+    node_base* prev(node_base* node) const {
         if (node == nullptr) {
             return nullptr;
         }
         if (node->left_child() != nullptr) {
             return maximum(node->left_child());
         }
-        NodeBase<T>* parent = node->parent();
+        node_base* parent = node->parent();
         while (parent != nullptr && node == parent->left_child()) {
             node = parent;
             parent = parent->parent();
@@ -688,13 +1660,13 @@ private:
         return parent;
     }
 
-    template <typename Compare>
-    NodeBase<T>* bound_node(const T& value, Compare go_left) const {
-        NodeBase<T>* current = root_;
-        NodeBase<T>* result = nullptr;
+    template <typename K, typename Predicate>
+    node_base* bound_node(const K& value, Predicate go_left) const {
+        node_base* current = root_;
+        node_base* result = nullptr;
 
         while (current != nullptr) {
-            const T& current_value = as_node(current)->value();
+            const key_type& current_value = key_of(current);
             if (go_left(value, current_value)) {
                 result = current;
                 current = current->left_child();
@@ -705,41 +1677,268 @@ private:
         return result;
     }
 
-    NodeBase<T>* lower_bound_node(const T& value) const {
+    template <typename K>
+    node_base* lower_bound_node(const K& value) const {
         return bound_node(
             value,
-            [](const T& target, const T& candidate) {
-                return candidate >= target;
+            [this](const K& target, const key_type& candidate) {
+                return !less(candidate, target);
             });
     }
 
-    NodeBase<T>* upper_bound_node(const T& value) const {
+    template <typename K>
+    node_base* upper_bound_node(const K& value) const {
         return bound_node(
             value,
-            [](const T& target, const T& candidate) {
-                return candidate > target;
+            [this](const K& target, const key_type& candidate) {
+                return less(target, candidate);
+            });
+    }
+
+    // Состояние одного спуска пакетного запроса.
+    struct Descent {
+        std::size_t query;
+        node_base* node;
+        // Левый ребёнок, чей размер ещё не прибавлен: он запрошен
+        // prefetch на прошлом шаге вместе с node.
+        node_base* pending;
+        size_t rank;
+        node_base* found;
+    };
+
+    // Ведёт count спусков, держа в работе до batch_group одновременно.
+    // step продвигает спуск на уровень, finish получает законченный спуск,
+    // а его место сразу занимает следующий запрос.
+    template <typename Step, typename Finish>
+    void interleave_descents(std::size_t count, Step step, Finish finish) const {
+        Descent slots[batch_group];
+        std::size_t active = 0;
+        std::size_t next = 0;
+        const auto start = [this, &next](Descent& descent) {
+            descent = Descent{next++, root_, nullptr, 0, nullptr};
+            detail::prefetch(root_);
+        };
+        while (active < batch_group && next < count) {
+            start(slots[active++]);
+        }
+
+        while (active != 0) {
+            for (std::size_t i = 0; i < active;) {
+                Descent& descent = slots[i];
+                if (!is_nil(descent.node)) {
+                    step(descent);
+                    ++i;
+                    continue;
+                }
+                finish(descent);
+                if (next < count) {
+                    start(descent);
+                    ++i;
+                } else {
+                    descent = slots[--active];
+                }
+            }
+        }
+    }
+
+    // Пакетный вариант rank_by: go_right(запрос, ключ узла) задаёт спуск,
+    // done(запрос, ранг) получает результат.
+    template <typename Predicate, typename Done>
+    void interleaved_ranks(std::size_t count, Predicate go_right, Done done) const {
+        static_assert(is_counted,
+                      "rb::Tree rank queries require CountedNodes traits");
+        interleave_descents(
+            count,
+            [this, &go_right](Descent& descent) {
+                node_base* node = descent.node;
+                descent.rank += node_size(descent.pending);
+                if (go_right(descent.query, key_of(node))) {
+                    descent.pending = node->left_child();
+                    descent.rank += 1;
+                    descent.node = node->right_child();
+                    detail::prefetch(descent.pending);
+                } else {
+                    descent.pending = nullptr;
+                    descent.node = node->left_child();
+                }
+                detail::prefetch(descent.node);
+            },
+            [this, &done](const Descent& descent) {
+                done(descent.query, descent.rank + node_size(descent.pending));
+            });
+    }
+
+    // Ключи пакета для спусков: при непрозрачном компараторе они
+    // приводятся к key_type один раз до начала спусков, а не на каждом
+    // уровне каждого спуска; иначе возвращается сам вектор.
+    template <typename K>
+    static decltype(auto) lookup_keys(const std::vector<K>& keys) {
+        if constexpr (detail::is_transparent_v<Compare> ||
+                      std::is_same_v<K, key_type>) {
+            return (keys);
+        } else {
+            return std::vector<key_type>(keys.begin(), keys.end());
+        }
+    }
+
+    template <typename K>
+    static decltype(auto) lookup_ranges(
+        const std::vector<std::pair<K, K>>& ranges) {
+        if constexpr (detail::is_transparent_v<Compare> ||
+                      std::is_same_v<K, key_type>) {
+            return (ranges);
+        } else {
+            std::vector<std::pair<key_type, key_type>> result;
+            result.reserve(ranges.size());
+            for (const auto& range : ranges) {
+                result.emplace_back(key_type(range.first),
+                                    key_type(range.second));
+            }
+            return result;
+        }
+    }
+
+    template <typename K>
+    std::vector<size_t> rank_batch_keys(const std::vector<K>& keys) const {
+        std::vector<size_t> result(keys.size());
+        interleaved_ranks(
+            keys.size(),
+            [this, &keys](std::size_t query, const key_type& current) {
+                return less(current, keys[query]);
+            },
+            [&result](std::size_t query, size_t rank) { result[query] = rank; });
+        return result;
+    }
+
+    template <typename K>
+    std::vector<size_t> distance_batch_keys(
+        const std::vector<std::pair<K, K>>& ranges) const {
+        // Чётные спуски считают ранг first, нечётные — число ключей,
+        // не больших second.
+        std::vector<size_t> bounds(2 * ranges.size());
+        interleaved_ranks(
+            bounds.size(),
+            [this, &ranges](std::size_t query, const key_type& current) {
+                const auto& range = ranges[query / 2];
+                return query % 2 == 0
+                           ? less(current, range.first)
+                           : !less(range.second, current);
+            },
+            [&bounds](std::size_t query, size_t rank) { bounds[query] = rank; });
+
+        std::vector<size_t> result(ranges.size());
+        for (std::size_t i = 0; i < ranges.size(); ++i) {
+            result[i] = bounds[2 * i + 1] > bounds[2 * i]
+                            ? bounds[2 * i + 1] - bounds[2 * i]
+                            : 0;
+        }
+        return result;
+    }
+
+    template <typename K>
+    std::vector<iterator> lower_bound_batch_keys(
+        const std::vector<K>& keys) const {
+        std::vector<iterator> result(keys.size(), end());
+        interleave_descents(
+            keys.size(),
+            [this, &keys](Descent& descent) {
+                node_base* node = descent.node;
+                if (!less(key_of(node), keys[descent.query])) {
+                    descent.found = node;
+                    descent.node = node->left_child();
+                } else {
+                    descent.node = node->right_child();
+                }
+                detail::prefetch(descent.node);
+            },
+            [this, &result](const Descent& descent) {
+                result[descent.query] = iterator(this, descent.found);
             });
+        return result;
+    }
+
+    // Спускается от subtree, ключи которого начинаются с ранга start, к
+    // первому узлу, для которого found(ключ) истинно. Если такого нет,
+    // ответ — fallback, стоящий сразу после поддерева (nullptr — конец).
+    template <typename Found>
+    ranked_iterator ranked_descent(node_base* subtree,
+                                   size_t start,
+                                   node_base* fallback,
+                                   Found found) const {
+        static_assert(is_counted,
+                      "rb::Tree rank queries require CountedNodes traits");
+        node_base* result = fallback;
+        size_t rank = fallback != nullptr ? start + node_size(subtree) : size_;
+        for (node_base* node = subtree; !is_nil(node);) {
+            const size_t left_size = node_size(node->left_child());
+            if (found(key_of(node))) {
+                result = node;
+                rank = start + left_size;
+                node = node->left_child();
+            } else {
+                start += left_size + 1;
+                node = node->right_child();
+            }
+        }
+        return ranked_iterator(iterator(this, result), rank);
+    }
+
+    // Считает узлы, для которых go_right(ключ узла, value) истинно.
+    template <typename K, typename Predicate>
+    size_t rank_by(const K& value, Predicate go_right) const {
+        static_assert(is_counted,
+                      "rb::Tree rank queries require CountedNodes traits");
+        const node_base* current = root_;
+        size_t result = 0;
+
+        while (!is_nil(current)) {
+            if (go_right(key_of(current), value)) {
+                result += node_size(current->left_child()) + 1;
+                current = current->right_child();
+            } else {
+                current = current->left_child();
+            }
+        }
+
+        return result;
+    }
+
+    // Спускается по размерам поддеревьев к k-му элементу.
+    node_base* select_node(size_t k) const {
+        node_base* current = root_;
+        while (!is_nil(current)) {
+            const size_t left_size = node_size(current->left_child());
+            if (k < left_size) {
+                current = current->left_child();
+            } else if (k == left_size) {
+                return current;
+            } else {
+                k -= left_size + 1;
+                current = current->right_child();
+            }
+        }
+        return nullptr;
     }
 
     // Обрабатывает удаление узла, у которого отсутствует один из детей.
-    DetachResult detach_node_with_single_child(NodeBase<T>* z,
-                                              NodeBase<T>* child) {
-        NodeBase<T>* parent = z->parent();
-        NodeBase<T>* replacement = child;
+    DetachResult detach_node_with_single_child(node_base* z,
+                                               node_base* child) {
+        node_base* parent = z->parent();
+        node_base* replacement = child;
         transplant(z, replacement);
 
-        NodeBase<T>* fixup_parent = (replacement != nullptr) ? replacement->parent()
+        node_base* fixup_parent = (replacement != nullptr) ? replacement->parent()
                                                               : parent;
         return {replacement, fixup_parent, z->color()};
     }
 
     // Обрабатывает удаление узла при наличии обоих детей, используя преемника.
-    DetachResult detach_node_with_successor(NodeBase<T>* z) {
-        NodeBase<T>* successor = minimum(z->right_child());
-        NodeBase<T>* x = successor->right_child();
+    DetachResult detach_node_with_successor(node_base* z) {
+        node_base* successor = minimum(z->right_child());
+        node_base* x = successor->right_child();
         node_color removed_color = successor->color();
         bool successor_parent_is_z = (successor->parent() == z);
-        NodeBase<T>* x_parent = nullptr;
+        node_base* x_parent = nullptr;
 
         if (!successor_parent_is_z) {
             x_parent = successor->parent();
@@ -761,8 +1960,8 @@ private:
             successor->left_child()->set_parent(successor);
         }
         successor->set_color(z->color());
-        recalc_size(successor);
-        update_size_upwards(successor);
+        recalc_node(successor);
+        update_upwards(successor);
 
         if (x != nullptr) {
             x_parent = x->parent();
@@ -774,7 +1973,7 @@ private:
     }
 
     // Переустанавливает узлы перед удалением, возвращая данные для исправления.
-    DetachResult detach_node(NodeBase<T>* z) {
+    DetachResult detach_node(node_base* z) {
         if (is_nil(z->left_child())) {
             return detach_node_with_single_child(z, z->right_child());
         }
@@ -787,8 +1986,8 @@ private:
     }
 
     // Заменяет одно поддерево другим и обновляет накопленные размеры.
-    void transplant(NodeBase<T>* u, NodeBase<T>* v) {
-        NodeBase<T>* parent = u->parent();
+    void transplant(node_base* u, node_base* v) {
+        node_base* parent = u->parent();
 
         if (parent == nullptr) {
             root_ = v;
@@ -800,10 +1999,10 @@ private:
         if (v != nullptr) {
             v->set_parent(parent);
         }
-        update_size_upwards(parent);
+        update_upwards(parent);
     }
 
-    void paint(NodeBase<T>* node, node_color color) {
+    void paint(node_base* node, node_color color) {
         if (!is_nil(node)) {
             node->set_color(color);
         }
@@ -812,8 +2011,8 @@ private:
     // Исправляет двойной чёрный в направлении dir: разворачивает красного брата,
     // перекрашивает sibling и parent и выполняет нужные повороты.
     // Обеспечивает чёрного брата: если sibling красный, переворачиваем узлы.
-    void ensure_black_sibling(NodeBase<T>*& parent,
-                              NodeBase<T>*& sibling,
+    void ensure_black_sibling(node_base*& parent,
+                              node_base*& sibling,
                               Direction dir) {
         if (is_red(sibling)) {
             paint(sibling, node_color::BLACK);
@@ -825,10 +2024,10 @@ private:
     }
 
     // Возвращает внутреннего и внешнего потомков брата относительно направления.
-    void fetch_sibling_children(NodeBase<T>* sibling,
+    void fetch_sibling_children(node_base* sibling,
                                 Direction dir,
-                                NodeBase<T>** inner,
-                                NodeBase<T>** outer) {
+                                node_base** inner,
+                                node_base** outer) {
         if (sibling == nullptr) {
             *inner = *outer = nullptr;
             return;
@@ -843,10 +2042,10 @@ private:
     }
 
     // Выполняет финальный поворот и перекраску после исправления двойного чёрного.
-    void apply_outer_rotation(NodeBase<T>*& node,
-                              NodeBase<T>*& parent,
-                              NodeBase<T>* sibling,
-                              NodeBase<T>* sibling_outer,
+    void apply_outer_rotation(node_base*& node,
+                              node_base*& parent,
+                              node_base* sibling,
+                              node_base* sibling_outer,
                               Direction dir) {
         paint(sibling, parent ? parent->color() : node_color::BLACK);
         paint(parent, node_color::BLACK);
@@ -856,22 +2055,22 @@ private:
         parent = nullptr;
     }
 
-    void erase_fixup_direction(NodeBase<T>*& node,
-                               NodeBase<T>*& parent,
+    void erase_fixup_direction(node_base*& node,
+                               node_base*& parent,
                                Direction dir) {
         if (parent == nullptr) {
             node = root_;
             return;
         }
 
-        NodeBase<T>* sibling =
+        node_base* sibling =
             (dir == Direction::LEFT) ? parent->right_child()
                                      : parent->left_child();
 
         ensure_black_sibling(parent, sibling, dir);
 
-        NodeBase<T>* sibling_inner = nullptr;
-        NodeBase<T>* sibling_outer = nullptr;
+        node_base* sibling_inner = nullptr;
+        node_base* sibling_outer = nullptr;
         fetch_sibling_children(sibling, dir, &sibling_inner, &sibling_outer);
 
         if (is_black(sibling_inner) && is_black(sibling_outer)) {
@@ -896,7 +2095,7 @@ private:
         apply_outer_rotation(node, parent, sibling, sibling_outer, dir);
     }
 
-    void erase_fixup(NodeBase<T>* node, NodeBase<T>* parent) {
+    void erase_fixup(node_base* node, node_base* parent) {
         while (node != root_ && is_black(node)) {
             if (parent != nullptr && node == parent->left_child()) {
                 erase_fixup_direction(node, parent, Direction::LEFT);
@@ -908,47 +2107,179 @@ private:
         paint(node, node_color::BLACK);
     }
 
-    // Рекурсивно проверяет инварианты поддерева.
-    bool validate_subtree(const NodeBase<T>* node,
-                          int* black_height_out) const {
-        if (node == nullptr) {
-            *black_height_out = 1;
-            return true;
-        }
+    // Итог проверки поддерева: чёрная высота считает nil-лист за 1.
+    struct SubtreeCheck {
+        bool valid = true;
+        int black_height = 1;
+        std::size_t size = 0;
+    };
 
-        const NodeBase<T>* left = node->left_child();
-        const NodeBase<T>* right = node->right_child();
+    using known_checks =
+        std::unordered_map<const node_base*, SubtreeCheck>;
+
+    // Итеративно проверяет поддерево: цвета, чёрные высоты, порядок ключей
+    // в границах (low, high), ссылки на родителей, размеры и сводки.
+    // Поддеревья из known уже проверены и не обходятся повторно.
+    SubtreeCheck check_subtree(const node_base* root,
+                               const key_type* low,
+                               const key_type* high,
+                               const known_checks* known) const {
+        struct Frame {
+            const node_base* node;
+            const key_type* low;
+            const key_type* high;
+            int stage;
+            SubtreeCheck left;
+        };
+
+        const SubtreeCheck nil_check;
+        const SubtreeCheck invalid{false, 0, 0};
+        if (root == nullptr) {
+            return nil_check;
+        }
 
-        if (node->color() == NodeBase<T>::Color::RED) {
-            if ((left != nullptr && left->color() == NodeBase<T>::Color::RED) ||
-                (right != nullptr && right->color() == NodeBase<T>::Color::RED)) {
-                return false;
+        std::vector<Frame> stack;
+        stack.push_back(Frame{root, low, high, 0, {}});
+        SubtreeCheck last;
+        while (!stack.empty()) {
+            const std::size_t top = stack.size() - 1;
+            const node_base* node = stack[top].node;
+            const node_base* left = node->left_child();
+            const node_base* right = node->right_child();
+            const key_type& key = key_of(node);
+
+            if (stack[top].stage == 0) {
+                if (known != nullptr && node != root) {
+                    const auto it = known->find(node);
+                    if (it != known->end()) {
+                        last = it->second;
+                        stack.pop_back();
+                        continue;
+                    }
+                }
+                if ((stack[top].low != nullptr && !less(*stack[top].low, key)) ||
+                    (stack[top].high != nullptr && !less(key, *stack[top].high))) {
+                    return invalid;
+                }
+                if (is_red(node) && (is_red(left) || is_red(right))) {
+                    return invalid;
+                }
+                if ((left != nullptr && left->parent() != node) ||
+                    (right != nullptr && right->parent() != node)) {
+                    return invalid;
+                }
+                stack[top].stage = 1;
+                if (left != nullptr) {
+                    stack.push_back(Frame{left, stack[top].low, &key, 0, {}});
+                } else {
+                    last = nil_check;
+                }
+            } else if (stack[top].stage == 1) {
+                stack[top].left = last;
+                stack[top].stage = 2;
+                if (right != nullptr) {
+                    stack.push_back(Frame{right, &key, stack[top].high, 0, {}});
+                } else {
+                    last = nil_check;
+                }
+            } else {
+                const SubtreeCheck left_check = stack[top].left;
+                const SubtreeCheck& right_check = last;
+                if (!left_check.valid || !right_check.valid ||
+                    left_check.black_height != right_check.black_height) {
+                    return invalid;
+                }
+                const std::size_t size = left_check.size + right_check.size + 1;
+                if constexpr (is_counted) {
+                    if (node->subtree_size() != size) {
+                        return invalid;
+                    }
+                }
+                if constexpr (has_augment &&
+                              detail::is_equality_comparable_v<summary_type>) {
+                    if (!(as_node(node)->summary() ==
+                          Augment::combine(
+                              Augment::combine(summary_of(left),
+                                               Augment::lift(as_node(node)->value())),
+                              summary_of(right)))) {
+                        return invalid;
+                    }
+                }
+                last = SubtreeCheck{
+                    true,
+                    left_check.black_height + (is_black(node) ? 1 : 0),
+                    size,
+                };
+                stack.pop_back();
             }
         }
+        return last;
+    }
 
-        int left_black_height = 0;
-        if (!validate_subtree(left, &left_black_height)) {
-            return false;
+    // Проверяет дерево, раздавая поддеревья верхнего уровня потокам.
+    bool validate_tree(unsigned threads) const {
+        if (root_ == nullptr) {
+            return size_ == 0;
         }
-
-        int right_black_height = 0;
-        if (!validate_subtree(right, &right_black_height)) {
+        if (!is_black(root_) || root_->parent() != nullptr) {
             return false;
         }
-
-        if (left_black_height != right_black_height) {
-            return false;
+        if (threads <= 1) {
+            const SubtreeCheck check =
+                check_subtree(root_, nullptr, nullptr, nullptr);
+            return check.valid && check.size == size_;
+        }
+
+        // Спускаемся по уровням, пока поддеревьев не станет хотя бы 4 на
+        // поток; их границы ключей задают предки.
+        struct Task {
+            const node_base* node;
+            const key_type* low;
+            const key_type* high;
+        };
+        std::vector<Task> frontier{Task{root_, nullptr, nullptr}};
+        const std::size_t target = std::size_t{4} * threads;
+        while (frontier.size() < target) {
+            std::vector<Task> next;
+            for (const Task& task : frontier) {
+                const key_type& key = key_of(task.node);
+                if (task.node->left_child() != nullptr) {
+                    next.push_back(Task{task.node->left_child(), task.low, &key});
+                }
+                if (task.node->right_child() != nullptr) {
+                    next.push_back(Task{task.node->right_child(), &key, task.high});
+                }
+            }
+            if (next.size() <= frontier.size()) {
+                break;
+            }
+            frontier = std::move(next);
         }
 
-        *black_height_out =
-            left_black_height +
-            (node->color() == NodeBase<T>::Color::BLACK ? 1 : 0);
-        return true;
+        std::vector<SubtreeCheck> results(frontier.size());
+        detail::run_parallel(
+            std::min<std::size_t>(threads, frontier.size()),
+            [&](std::size_t worker) {
+                for (std::size_t i = worker; i < frontier.size(); i += threads) {
+                    results[i] = check_subtree(frontier[i].node, frontier[i].low,
+                                               frontier[i].high, nullptr);
+                }
+            });
+
+        known_checks known;
+        for (std::size_t i = 0; i < frontier.size(); ++i) {
+            if (!results[i].valid) {
+                return false;
+            }
+            known.emplace(frontier[i].node, results[i]);
+        }
+        const SubtreeCheck check = check_subtree(root_, nullptr, nullptr, &known);
+        return check.valid && check.size == size_;
     }
 
     // Клонирует поддерево, переназначая родительские указатели.
-    NodeBase<T>* clone_subtree(const NodeBase<T>* node,
-                               NodeBase<T>* parent) {
+    node_base* clone_subtree(const node_base* node,
+                             node_base* parent) {
         if (node == nullptr) {
             return nullptr;
         }
@@ -959,32 +2290,32 @@ private:
                                    nullptr,
                                    parent);
 
-        NodeBase<T>* left_child = clone_subtree(node->left_child(), new_node);
+        node_base* left_child = clone_subtree(node->left_child(), new_node);
         new_node->set_left_child(left_child);
         if (left_child != nullptr) {
             left_child->set_parent(new_node);
         }
 
-        NodeBase<T>* right_child = clone_subtree(node->right_child(), new_node);
+        node_base* right_child = clone_subtree(node->right_child(), new_node);
         new_node->set_right_child(right_child);
         if (right_child != nullptr) {
             right_child->set_parent(new_node);
         }
 
-        recalc_size(new_node);
+        recalc_node(new_node);
         return new_node;
     }
 
     // Возвращает порядковый номер узла в симметричном обходе.
-    size_t order_statistics(const NodeBase<T>* node) const {
+    size_t order_statistics(const node_base* node) const {
         size_t count = 0;
-        const T& target = as_node(node)->value();
-        const NodeBase<T>* current = root_;
+        const key_type& target = key_of(node);
+        const node_base* current = root_;
         while (!is_nil(current)) {
-            const T& current_value = as_node(current)->value();
-            if (target < current_value) {
+            const auto order = compare3(target, key_of(current));
+            if (order < 0) {
                 current = current->left_child();
-            } else if (current_value < target) {
+            } else if (order > 0) {
                 count += subtree_size(current->left_child()) + 1;
                 current = current->right_child();
             } else {
@@ -995,7 +2326,7 @@ private:
         return count;
     }
 
-    size_t subtree_size(const NodeBase<T>* node) const {
+    size_t subtree_size(const node_base* node) const {
         if (is_nil(node)) {
             return 0;
         }
@@ -3,7 +3,38 @@
 #include <iosfwd>
 
 namespace rb {
+
+// Структура, отвечающая на запросы CLI.
+enum class Engine {
+    TREE,      // rb::Tree<int>, любые ключи
+    BITVECTOR, // rb::BitvectorSet, ключи из [0, max_key]
+    FENWICK,   // rb::FenwickSet, ключи из [0, max_key]
+};
+
+// Наибольшее допустимое значение --threads.
+constexpr unsigned max_cli_threads = 256;
+
+struct CliOptions {
+    Engine engine = Engine::TREE;
+    int max_key = 1000000;
+    // Потоки для серий запросов q, s и r между изменениями, от 1 до
+    // max_cli_threads; больше числа ядер не запускается.
+    unsigned threads = 1;
+};
+
+// Разбирает --engine=tree|bitvector|fenwick, --max=<N> и --threads=<N>
+// (от 1 до max_cli_threads); при ошибке пишет в error.
+bool parse_cli_options(int argc,
+                       char* argv[],
+                       CliOptions& options,
+                       std::ostream& error);
+
 int run_cli(std::istream& input,
             std::ostream& output,
             std::ostream& error);
+
+int run_cli(std::istream& input,
+            std::ostream& output,
+            std::ostream& error,
+            const CliOptions& options);
 } //namespace rb
@@ -1,14 +1,18 @@
 #include "rb_tree_cli_iter.hpp"
 
+#include "rb_cli_common.hpp"
 #include "rb_tree.hpp"
 
 #include <cstddef>
 #include <istream>
-#include <iterator>
+#include <memory_resource>
 #include <ostream>
 
 namespace {
 
+using rb::detail::print_result;
+using rb::detail::session_arena_block;
+
 void handle_query(rb::Tree<int>& tree,
                   int left,
                   int right,
@@ -17,15 +21,26 @@ void handle_query(rb::Tree<int>& tree,
     std::size_t result = 0;
 
     if (right >= left) {
-        result = static_cast<std::size_t>(
-            std::distance(tree.lower_bound(left), tree.upper_bound(right)));
+        // Ранги итераторов найдены теми же спусками, разность — O(1).
+        result = static_cast<std::size_t>(tree.ranked_upper_bound(right) -
+                                          tree.ranked_lower_bound(left));
     }
 
-    if (!first_output) {
-        output << ' ';
+    print_result(result, first_output, output);
+}
+
+// s <k>: k-й ключ с единицы через ranked_select или none.
+void handle_select(const rb::Tree<int>& tree,
+                   long long k,
+                   bool& first_output,
+                   std::ostream& output) {
+    const auto it = k > 0 ? tree.ranked_select(static_cast<std::size_t>(k - 1))
+                          : tree.ranked_end();
+    if (it == tree.ranked_end()) {
+        print_result("none", first_output, output);
+    } else {
+        print_result(*it, first_output, output);
     }
-    output << result;
-    first_output = false;
 }
 
 } // namespace
@@ -33,7 +48,10 @@ namespace rb {
 int run_cli_iter(std::istream& input,
                  std::ostream& output,
                  std::ostream& error) {
-    rb::Tree<int> tree;
+    // Узлы сессии берутся из пула поверх арены, см. run_cli.
+    std::pmr::monotonic_buffer_resource arena(session_arena_block);
+    std::pmr::unsynchronized_pool_resource pool(&arena);
+    rb::Tree<int> tree(&pool, rb::release_nodes_with_resource);
     bool first_output = true;
 
     char action = '\0';
@@ -53,6 +71,28 @@ int run_cli_iter(std::istream& input,
                 return 1;
             }
             handle_query(tree, left, right, first_output, output);
+        } else if (action == 'd') {
+            int key = 0;
+            if (!(input >> key)) {
+                error << "Failed to read key value\n";
+                return 1;
+            }
+            tree.erase(key);
+        } else if (action == 's') {
+            long long k = 0;
+            if (!(input >> k)) {
+                error << "Failed to read select index\n";
+                return 1;
+            }
+            handle_select(tree, k, first_output, output);
+        } else if (action == 'r') {
+            int key = 0;
+            if (!(input >> key)) {
+                error << "Failed to read key value\n";
+                return 1;
+            }
+            // Ранг — побочный результат спуска lower_bound.
+            print_result(tree.ranked_lower_bound(key).rank(), first_output, output);
         } else {
             error << "Unknown command: " << action << '\n';
             return 1;
@@ -1,71 +1,410 @@
 #include "rb_tree_cli.hpp"
 
+#include "rb_bitvector.hpp"
+#include "rb_cli_common.hpp"
+#include "rb_fenwick.hpp"
 #include "rb_tree.hpp"
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <istream>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 namespace {
 
-void handle_query(rb::Tree<int>& tree,
-                  int left,
-                  int right,
-                  bool& first_output,
-                  std::ostream& output) {
-    size_t result = 0;
-
-    result = tree.distance(left, right);
-    // if (right >= left) {
-    //     const size_t right_rank = tree.rank_comp_bound(right, rb::compare_upper_bound<int>);
-    //     const size_t left_rank = tree.rank_comp_bound(left, rb::compare_lower_bound<int>);
-    //     if (right_rank > left_rank) {
-    //         result = right_rank - left_rank;
-    //     }
-    // }
+using rb::detail::print_result;
+using rb::detail::session_arena_block;
 
-    if (!first_output) {
-        output << ' ';
+bool parse_argument(std::string_view arg,
+                    std::string_view name,
+                    std::string& value) {
+    if (arg.size() <= name.size() || arg.compare(0, name.size(), name) != 0) {
+        return false;
+    }
+    if (arg[name.size()] != '=') {
+        return false;
     }
-    output << result;
-    first_output = false;
+    value.assign(arg.begin() + static_cast<std::ptrdiff_t>(name.size()) + 1,
+                 arg.end());
+    return true;
 }
 
-} // namespace
-namespace rb {
-int run_cli(std::istream& input,
-            std::ostream& output,
-            std::ostream& error) {
-    rb::Tree<int> tree;
+bool insert_key(rb::Tree<int>& tree, int key) {
+    tree.insert(key);
+    return true;
+}
+
+// Множества с ограниченным диапазоном принимают только ключи из него.
+template <typename BoundedSet>
+bool insert_key(BoundedSet& set, int key) {
+    if (key < 0 || static_cast<std::size_t>(key) >= set.universe()) {
+        return false;
+    }
+    set.insert(static_cast<typename BoundedSet::key_type>(key));
+    return true;
+}
+
+bool erase_key(rb::Tree<int>& tree, int key) {
+    return tree.erase(key);
+}
+
+template <typename BoundedSet>
+bool erase_key(BoundedSet& set, int key) {
+    return key >= 0 && static_cast<std::size_t>(key) < set.universe() &&
+           set.erase(static_cast<typename BoundedSet::key_type>(key));
+}
+
+// k-й по возрастанию ключ (с нуля).
+std::optional<long long> select_key(const rb::Tree<int>& tree, std::size_t k) {
+    const auto it = tree.select(k);
+    if (it == tree.end()) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+template <typename BoundedSet>
+std::optional<long long> select_key(const BoundedSet& set, std::size_t k) {
+    const auto key = set.select(k);
+    if (!key) {
+        return std::nullopt;
+    }
+    return static_cast<long long>(*key);
+}
+
+// Команда q, s или r. Между изменениями дерево не меняется, поэтому
+// такие команды копятся в эпоху и выполняются вместе.
+struct PendingQuery {
+    char action;
+    long long first;
+    int second;
+};
+
+// Эпохи короче этого порога выполняются в одном потоке: раздача работы
+// потокам обошлась бы дороже самих запросов.
+constexpr std::size_t min_parallel_epoch = 4096;
+// Длинная серия запросов сбрасывается частями, чтобы не копить память.
+constexpr std::size_t max_epoch = std::size_t{1} << 16;
+
+// Ответ на запрос; nullopt — none для s вне диапазона.
+template <typename Set>
+std::optional<long long> answer(const Set& tree, const PendingQuery& query) {
+    if (query.action == 'q') {
+        return static_cast<long long>(
+            tree.distance(static_cast<int>(query.first), query.second));
+    }
+    if (query.action == 'r') {
+        return static_cast<long long>(tree.rank(static_cast<int>(query.first)));
+    }
+    // s <k>: k-й по возрастанию ключ с единицы.
+    if (query.first <= 0) {
+        return std::nullopt;
+    }
+    return select_key(tree, static_cast<std::size_t>(query.first - 1));
+}
+
+// Потоки сессии для длинных эпох. Они запускаются при первой такой эпохе
+// и ждут следующих до конца сессии, так что эпоха не платит за создание
+// потоков.
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threads) : threads_(threads) {}
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    unsigned size() const { return threads_; }
+
+    // Вызывает job(i) для i из [0, size()); последнюю часть выполняет
+    // вызывающий поток. Первое исключение заданий пробрасывается, когда
+    // закончены все части.
+    void run(const std::function<void(std::size_t)>& job) {
+        if (workers_.size() + 1 < threads_) {
+            start();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            errors_.assign(threads_, nullptr);
+            pending_ = workers_.size();
+            ++generation_;
+        }
+        wake_.notify_all();
+        perform(threads_ - 1);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return pending_ == 0; });
+            job_ = nullptr;
+        }
+        for (const auto& error : errors_) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+private:
+    void start() {
+        workers_.reserve(threads_ - 1);
+        for (std::size_t i = workers_.size(); i + 1 < threads_; ++i) {
+            workers_.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    void work(std::size_t index) {
+        std::uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this, seen] {
+                    return stopping_ || generation_ != seen;
+                });
+                if (stopping_) {
+                    return;
+                }
+                seen = generation_;
+            }
+            perform(index);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) {
+                done_.notify_one();
+            }
+        }
+    }
+
+    void perform(std::size_t index) {
+        try {
+            (*job_)(index);
+        } catch (...) {
+            errors_[index] = std::current_exception();
+        }
+    }
+
+    unsigned threads_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(std::size_t)>* job_ = nullptr;
+    std::vector<std::exception_ptr> errors_;
+    std::size_t pending_ = 0;
+    std::uint64_t generation_ = 0;
+    bool stopping_ = false;
+};
+
+// Выполняет накопленные запросы на потоках пула и печатает ответы в
+// исходном порядке.
+template <typename Set>
+void flush_epoch(const Set& tree,
+                 std::vector<PendingQuery>& epoch,
+                 WorkerPool& pool,
+                 bool& first_output,
+                 std::ostream& output) {
+    std::vector<std::optional<long long>> answers(epoch.size());
+    const auto answer_range = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            answers[i] = answer(tree, epoch[i]);
+        }
+    };
+    if (epoch.size() < min_parallel_epoch || pool.size() == 1) {
+        answer_range(0, epoch.size());
+    } else {
+        const std::size_t workers = pool.size();
+        pool.run([&](std::size_t worker) {
+            answer_range(epoch.size() * worker / workers,
+                         epoch.size() * (worker + 1) / workers);
+        });
+    }
+
+    for (const auto& result : answers) {
+        if (result) {
+            print_result(*result, first_output, output);
+        } else {
+            print_result("none", first_output, output);
+        }
+    }
+    epoch.clear();
+}
+
+template <typename Set>
+int run_commands(Set& tree,
+                 std::istream& input,
+                 std::ostream& output,
+                 std::ostream& error,
+                 unsigned threads) {
     bool first_output = true;
+    std::vector<PendingQuery> epoch;
+    WorkerPool pool(threads);
+    const auto flush = [&] {
+        flush_epoch(tree, epoch, pool, first_output, output);
+    };
 
     char action = '\0';
     while (input >> action) {
+        if (epoch.size() == max_epoch ||
+            (!epoch.empty() && (action == 'k' || action == 'd'))) {
+            flush();
+        }
         if (action == 'k') {
             int key = 0;
             if (!(input >> key)) {
                 error << "Failed to read key value\n";
                 return 1;
             }
-            tree.insert(key);
+            if (!insert_key(tree, key)) {
+                error << "Key out of range: " << key << '\n';
+                return 1;
+            }
         } else if (action == 'q') {
             int left = 0;
             int right = 0;
             if (!(input >> left >> right)) {
+                flush();
                 error << "Failed to read query bounds\n";
                 return 1;
             }
-            handle_query(tree, left, right, first_output, output);
+            epoch.push_back({action, left, right});
+        } else if (action == 'd') {
+            int key = 0;
+            if (!(input >> key)) {
+                error << "Failed to read key value\n";
+                return 1;
+            }
+            erase_key(tree, key);
+        } else if (action == 's') {
+            long long k = 0;
+            if (!(input >> k)) {
+                flush();
+                error << "Failed to read select index\n";
+                return 1;
+            }
+            epoch.push_back({action, k, 0});
+        } else if (action == 'r') {
+            int key = 0;
+            if (!(input >> key)) {
+                flush();
+                error << "Failed to read key value\n";
+                return 1;
+            }
+            epoch.push_back({action, key, 0});
         } else {
+            flush();
             error << "Unknown command: " << action << '\n';
             return 1;
         }
     }
+    flush();
 
     if (!first_output) {
         output << '\n';
     }
 
     return 0;
+}
+
+} // namespace
+namespace rb {
+bool parse_cli_options(int argc,
+                       char* argv[],
+                       CliOptions& options,
+                       std::ostream& error) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+        std::string value;
+        if (parse_argument(arg, "--engine", value)) {
+            if (value == "tree") {
+                options.engine = Engine::TREE;
+            } else if (value == "bitvector") {
+                options.engine = Engine::BITVECTOR;
+            } else if (value == "fenwick") {
+                options.engine = Engine::FENWICK;
+            } else {
+                error << "Unknown engine: " << value << '\n';
+                return false;
+            }
+        } else if (parse_argument(arg, "--threads", value)) {
+            int threads = 0;
+            try {
+                threads = std::stoi(value);
+            } catch (const std::exception&) {
+            }
+            if (threads < 1 || threads > static_cast<int>(max_cli_threads)) {
+                error << "Invalid --threads value: " << value << '\n';
+                return false;
+            }
+            options.threads = static_cast<unsigned>(threads);
+        } else if (parse_argument(arg, "--max", value)) {
+            try {
+                options.max_key = std::stoi(value);
+            } catch (const std::exception&) {
+                options.max_key = -1;
+            }
+            if (options.max_key < 0) {
+                error << "Invalid --max value: " << value << '\n';
+                return false;
+            }
+        } else {
+            error << "Unknown argument: " << arg << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+int run_cli(std::istream& input,
+            std::ostream& output,
+            std::ostream& error) {
+    return run_cli(input, output, error, CliOptions{});
+}
+
+int run_cli(std::istream& input,
+            std::ostream& output,
+            std::ostream& error,
+            const CliOptions& options) {
+    const std::size_t universe = static_cast<std::size_t>(options.max_key) + 1;
+    // Потоков сверх числа ядер эпоха не ускоряет; 0 от
+    // hardware_concurrency значит, что число ядер неизвестно.
+    const unsigned cores = std::thread::hardware_concurrency();
+    const unsigned threads = std::clamp(
+        options.threads, 1u, cores != 0 ? std::min(cores, max_cli_threads)
+                                        : max_cli_threads);
+    if (options.engine == Engine::BITVECTOR) {
+        rb::BitvectorSet set(universe);
+        return run_commands(set, input, output, error, threads);
+    }
+    if (options.engine == Engine::FENWICK) {
+        rb::FenwickSet set(universe);
+        return run_commands(set, input, output, error, threads);
+    }
+    // Дерево живёт одну сессию: узлы берутся из арены без malloc на каждую
+    // вставку, а пул поверх неё снова выдаёт узлы, освобождённые командой d,
+    // так что чередование k и d не растит память. В конце сессии узлы не
+    // обходятся: их память возвращают пул и арена.
+    std::pmr::monotonic_buffer_resource arena(session_arena_block);
+    std::pmr::unsynchronized_pool_resource pool(&arena);
+    rb::Tree<int> tree(&pool, rb::release_nodes_with_resource);
+    return run_commands(tree, input, output, error, threads);
 } 
 } //namespace rb
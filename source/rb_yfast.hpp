@@ -0,0 +1,373 @@
+#pragma once
+
+#include "rb_tree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rb {
+
+namespace detail {
+
+// x-fast trie над 64-битными ключами: для каждой длины префикса хеш-таблица
+// с минимумом и максимумом ключей поддерева, листья связаны в список.
+// Предшественник ищется двоичным поиском по длине префикса — O(log w)
+// обращений к хеш-таблицам; вставка и удаление стоят O(w).
+class XFastTrie {
+public:
+    static constexpr unsigned word_bits = 64;
+
+    bool empty() const { return levels_[0].empty(); }
+
+    bool contains(std::uint64_t key) const {
+        return levels_[word_bits].count(key) != 0;
+    }
+
+    // Наибольший ключ, не больший key.
+    std::optional<std::uint64_t> predecessor(std::uint64_t key) const {
+        if (empty()) {
+            return std::nullopt;
+        }
+        if (contains(key)) {
+            return key;
+        }
+
+        unsigned low = 0;
+        unsigned high = word_bits - 1;
+        while (low < high) {
+            const unsigned middle = (low + high + 1) / 2;
+            if (levels_[middle].count(prefix(key, middle)) != 0) {
+                low = middle;
+            } else {
+                high = middle - 1;
+            }
+        }
+
+        // У узла с самым длинным общим префиксом нет ребёнка в сторону key,
+        // поэтому всё его поддерево лежит по одну сторону от key.
+        const Range& range = levels_[low].at(prefix(key, low));
+        const bool key_goes_right = (key >> (word_bits - 1 - low)) & 1u;
+        if (key_goes_right) {
+            return range.max;
+        }
+        return links_.at(range.min).prev;
+    }
+
+    // Наименьший ключ, строго больший key.
+    std::optional<std::uint64_t> successor(std::uint64_t key) const {
+        const auto previous = predecessor(key);
+        if (!previous) {
+            return min();
+        }
+        return links_.at(*previous).next;
+    }
+
+    std::optional<std::uint64_t> min() const {
+        if (empty()) {
+            return std::nullopt;
+        }
+        return levels_[0].at(0).min;
+    }
+
+    void insert(std::uint64_t key) {
+        assert(!contains(key));
+        const auto previous = predecessor(key);
+        const auto next = previous ? links_.at(*previous).next : min();
+        links_[key] = Link{previous, next};
+        if (previous) {
+            links_[*previous].next = key;
+        }
+        if (next) {
+            links_[*next].prev = key;
+        }
+
+        for (unsigned level = 0; level <= word_bits; ++level) {
+            auto [it, inserted] =
+                levels_[level].try_emplace(prefix(key, level), Range{key, key});
+            if (!inserted) {
+                it->second.min = std::min(it->second.min, key);
+                it->second.max = std::max(it->second.max, key);
+            }
+        }
+    }
+
+    void erase(std::uint64_t key) {
+        assert(contains(key));
+        const Link link = links_.at(key);
+        if (link.prev) {
+            links_[*link.prev].next = link.next;
+        }
+        if (link.next) {
+            links_[*link.next].prev = link.prev;
+        }
+        links_.erase(key);
+
+        levels_[word_bits].erase(key);
+        for (unsigned level = word_bits; level-- > 0;) {
+            const std::uint64_t node = prefix(key, level);
+            const auto& children = levels_[level + 1];
+            const auto left = children.find(child(node, level, 0));
+            const auto right = children.find(child(node, level, 1));
+            if (left == children.end() && right == children.end()) {
+                levels_[level].erase(node);
+                continue;
+            }
+            Range& range = levels_[level].at(node);
+            range.min = left != children.end() ? left->second.min
+                                               : right->second.min;
+            range.max = right != children.end() ? right->second.max
+                                                : left->second.max;
+        }
+    }
+
+private:
+    struct Range {
+        std::uint64_t min;
+        std::uint64_t max;
+    };
+
+    struct Link {
+        std::optional<std::uint64_t> prev;
+        std::optional<std::uint64_t> next;
+    };
+
+    static std::uint64_t prefix(std::uint64_t key, unsigned level) {
+        return level == 0 ? 0 : key >> (word_bits - level);
+    }
+
+    static std::uint64_t child(std::uint64_t node, unsigned level, unsigned bit) {
+        return level == 0 ? bit : (node << 1) | bit;
+    }
+
+    std::array<std::unordered_map<std::uint64_t, Range>, word_bits + 1> levels_;
+    std::unordered_map<std::uint64_t, Link> links_;
+};
+
+// Сумма размеров корзин в дереве представителей.
+struct BucketSizeAugment {
+    using summary_type = std::size_t;
+
+    static summary_type identity() { return 0; }
+    static summary_type lift(const std::pair<std::uint64_t, std::size_t>& bucket) {
+        return bucket.second;
+    }
+    static summary_type combine(summary_type lhs, summary_type rhs) {
+        return lhs + rhs;
+    }
+};
+
+} // namespace detail
+
+// y-fast trie для 64-битных ключей. Ключи разложены по отсортированным
+// корзинам примерно по w = 64 штуки; корзину задаёт представитель — нижняя
+// граница её ключей. Представители лежат в x-fast trie, поэтому поиск
+// корзины, lower_bound и contains стоят O(log log U) плюс O(log w) внутри
+// корзины. Для рангов размеры корзин хранятся в rb::Tree с суммой по
+// поддереву: динамический ранг не бывает быстрее Ω(log n / log log n), и
+// здесь он стоит O(log(n / w)) — высота дерева над n / w корзинами, а не
+// над n ключами. Вставка и удаление амортизированно O(log(n / w) + w).
+class YFastSet {
+public:
+    using key_type = std::uint64_t;
+
+    static constexpr std::size_t bucket_size = 64;
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Вставляет ключ; false при дубликате.
+    bool insert(key_type key) {
+        auto rep = top_.predecessor(key);
+        if (!rep) {
+            if (top_.empty()) {
+                add_bucket(key, Bucket{key});
+                ++size_;
+                return true;
+            }
+            // Новый минимум: опускаем границу первой корзины.
+            rep = top_.min();
+            Bucket keys = std::move(buckets_.at(*rep));
+            remove_bucket(*rep);
+            add_bucket(key, std::move(keys));
+            rep = key;
+        }
+
+        Bucket& bucket = buckets_.at(*rep);
+        const auto it = std::lower_bound(bucket.begin(), bucket.end(), key);
+        if (it != bucket.end() && *it == key) {
+            return false;
+        }
+        bucket.insert(it, key);
+        ++size_;
+
+        if (bucket.size() > 2 * bucket_size) {
+            split_bucket(*rep);
+        } else {
+            update_count(*rep);
+        }
+        return true;
+    }
+
+    // Удаляет ключ; false, если его нет.
+    bool erase(key_type key) {
+        const auto rep = top_.predecessor(key);
+        if (!rep) {
+            return false;
+        }
+        Bucket& bucket = buckets_.at(*rep);
+        const auto it = std::lower_bound(bucket.begin(), bucket.end(), key);
+        if (it == bucket.end() || *it != key) {
+            return false;
+        }
+        bucket.erase(it);
+        --size_;
+
+        if (bucket.size() < bucket_size / 4) {
+            merge_bucket(*rep);
+        } else {
+            update_count(*rep);
+        }
+        return true;
+    }
+
+    bool contains(key_type key) const {
+        const auto rep = top_.predecessor(key);
+        if (!rep) {
+            return false;
+        }
+        const Bucket& bucket = buckets_.at(*rep);
+        return std::binary_search(bucket.begin(), bucket.end(), key);
+    }
+
+    // Наименьший ключ, не меньший key.
+    std::optional<key_type> lower_bound(key_type key) const {
+        auto rep = top_.predecessor(key);
+        if (rep) {
+            const Bucket& bucket = buckets_.at(*rep);
+            const auto it = std::lower_bound(bucket.begin(), bucket.end(), key);
+            if (it != bucket.end()) {
+                return *it;
+            }
+            rep = top_.successor(*rep);
+        } else {
+            rep = top_.min();
+        }
+        if (!rep) {
+            return std::nullopt;
+        }
+        return buckets_.at(*rep).front();
+    }
+
+    // Количество ключей, строго меньших key.
+    std::size_t rank(key_type key) const {
+        const auto rep = top_.predecessor(key);
+        if (!rep) {
+            return 0;
+        }
+        const Bucket& bucket = buckets_.at(*rep);
+        const std::size_t before =
+            *rep == 0 ? 0 : counts_.aggregate(key_type{0}, *rep - 1);
+        return before + static_cast<std::size_t>(
+                            std::lower_bound(bucket.begin(), bucket.end(), key) -
+                            bucket.begin());
+    }
+
+    // Количество ключей в отрезке [first, second].
+    std::size_t distance(key_type first, key_type second) const {
+        if (second < first) {
+            return 0;
+        }
+        const std::size_t high =
+            second == max_key ? size_ : rank(second + 1);
+        return high - rank(first);
+    }
+
+private:
+    using Bucket = std::vector<key_type>;
+    using CountTree = Tree<std::pair<key_type, std::size_t>,
+                           detail::BucketSizeAugment,
+                           SelectFirst>;
+
+    static constexpr key_type max_key = ~key_type{0};
+
+    void add_bucket(key_type rep, Bucket keys) {
+        top_.insert(rep);
+        counts_.insert({rep, keys.size()});
+        buckets_.emplace(rep, std::move(keys));
+    }
+
+    void remove_bucket(key_type rep) {
+        top_.erase(rep);
+        counts_.erase(rep);
+        buckets_.erase(rep);
+    }
+
+    // Обновляет размер корзины на месте, пересчитывая суммы до корня.
+    void update_count(key_type rep) {
+        const std::size_t size = buckets_.at(rep).size();
+        counts_.modify(rep, [size](auto& bucket) { bucket.second = size; });
+    }
+
+    // Делит переполненную корзину пополам.
+    void split_bucket(key_type rep) {
+        Bucket& bucket = buckets_.at(rep);
+        const auto middle =
+            bucket.begin() + static_cast<std::ptrdiff_t>(bucket.size() / 2);
+        Bucket upper(middle, bucket.end());
+        bucket.erase(middle, bucket.end());
+        update_count(rep);
+        const key_type upper_rep = upper.front();
+        add_bucket(upper_rep, std::move(upper));
+    }
+
+    // Сливает почти пустую корзину с соседней слева (или справа для первой).
+    void merge_bucket(key_type rep) {
+        const auto previous = rep == 0 ? std::nullopt : top_.predecessor(rep - 1);
+        if (previous) {
+            Bucket keys = std::move(buckets_.at(rep));
+            remove_bucket(rep);
+            Bucket& target = buckets_.at(*previous);
+            target.insert(target.end(), keys.begin(), keys.end());
+            if (target.size() > 2 * bucket_size) {
+                split_bucket(*previous);
+            } else {
+                update_count(*previous);
+            }
+            return;
+        }
+
+        const auto next = top_.successor(rep);
+        if (!next) {
+            if (buckets_.at(rep).empty()) {
+                remove_bucket(rep);
+            } else {
+                update_count(rep);
+            }
+            return;
+        }
+        // Первая корзина забирает ключи следующей и сохраняет свою границу.
+        Bucket keys = std::move(buckets_.at(*next));
+        remove_bucket(*next);
+        Bucket& target = buckets_.at(rep);
+        target.insert(target.end(), keys.begin(), keys.end());
+        if (target.size() > 2 * bucket_size) {
+            split_bucket(rep);
+        } else {
+            update_count(rep);
+        }
+    }
+
+    detail::XFastTrie top_;
+    std::unordered_map<key_type, Bucket> buckets_;
+    CountTree counts_;
+    std::size_t size_ = 0;
+};
+
+} // namespace rb
@@ -1,6 +1,11 @@
+#include "rb_cli_common.hpp"
+
 #include <iostream>
+#include <iterator>
 #include <set>
 
+using rb::detail::print_result;
+
 int main() {
     std::set<long long> tree;
     bool first_output = true;
@@ -21,23 +26,38 @@ int main() {
             }
 
             if (right < left) {
-                if (!first_output) {
-                    std::cout << ' ';
-                }
-                std::cout << 0;
-                first_output = false;
+                print_result(0, first_output, std::cout);
                 continue;
             }
 
             const auto begin = tree.lower_bound(left);
             const auto end = tree.upper_bound(right);
-            const auto result = std::distance(begin, end);
-
-            if (!first_output) {
-                std::cout << ' ';
+            print_result(std::distance(begin, end), first_output, std::cout);
+        } else if (command == 'd') {
+            long long key = 0;
+            if (!(std::cin >> key)) {
+                return 1;
+            }
+            tree.erase(key);
+        } else if (command == 's') {
+            // У std::set нет порядковой статистики: k-й ключ ищется за O(k).
+            long long k = 0;
+            if (!(std::cin >> k)) {
+                return 1;
+            }
+            if (k <= 0 || static_cast<unsigned long long>(k) > tree.size()) {
+                print_result("none", first_output, std::cout);
+            } else {
+                print_result(*std::next(tree.begin(), k - 1), first_output,
+                             std::cout);
+            }
+        } else if (command == 'r') {
+            long long key = 0;
+            if (!(std::cin >> key)) {
+                return 1;
             }
-            std::cout << result;
-            first_output = false;
+            print_result(std::distance(tree.begin(), tree.lower_bound(key)),
+                         first_output, std::cout);
         } else {
             return 1;
         }
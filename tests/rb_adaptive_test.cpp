@@ -0,0 +1,91 @@
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include "rb_adaptive.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(RBAdaptiveTest, SwitchesRepresentationAndMatchesStdSet) {
+    rb::AdaptiveSet<int, 16> set;
+    std::set<int> reference;
+    std::mt19937 rng{3030};
+    std::uniform_int_distribution<int> value_dist(0, 60);
+    bool seen_tree = false;
+    bool returned_inline = false;
+
+    for (int step = 0; step < 5000; ++step) {
+        const int value = value_dist(rng);
+        // Смещаем баланс вставок и удалений, чтобы размер ходил через порог.
+        const bool erase = (step / 500) % 2 == 1 ? rng() % 4 != 0 : rng() % 4 == 0;
+        if (erase) {
+            ASSERT_EQ(set.erase(value), reference.erase(value) == 1);
+        } else {
+            ASSERT_EQ(set.insert(value), reference.insert(value).second);
+        }
+        ASSERT_EQ(set.size(), reference.size());
+        ASSERT_TRUE(set.is_valid());
+        seen_tree |= !set.is_inline();
+        returned_inline |= seen_tree && set.is_inline();
+
+        const int key = value_dist(rng);
+        const auto lower = reference.lower_bound(key);
+        ASSERT_EQ(set.rank(key),
+                  static_cast<std::size_t>(std::distance(reference.begin(), lower)));
+        ASSERT_EQ(set.contains(key), reference.count(key) == 1);
+        const int* found = set.lower_bound(key);
+        ASSERT_EQ(found != nullptr, lower != reference.end());
+        if (found != nullptr) {
+            ASSERT_EQ(*found, *lower);
+        }
+        ASSERT_EQ(set.distance(key, key + 10),
+                  static_cast<std::size_t>(
+                      std::distance(lower, reference.upper_bound(key + 10))));
+    }
+    EXPECT_TRUE(seen_tree);
+    EXPECT_TRUE(returned_inline);
+
+    std::size_t index = 0;
+    for (int value : reference) {
+        ASSERT_NE(set.select(index), nullptr);
+        EXPECT_EQ(*set.select(index++), value);
+    }
+    EXPECT_EQ(set.select(index), nullptr);
+}
+
+TEST(RBAdaptiveTest, WorksWithNonArithmeticKeys) {
+    rb::AdaptiveSet<std::string, 4, rb::ThreeWayLess> set;
+    for (const char* word : {"delta", "alpha", "echo", "bravo", "charlie"}) {
+        ASSERT_TRUE(set.insert(std::string(word)));
+    }
+    EXPECT_FALSE(set.is_inline());
+    EXPECT_FALSE(set.insert(std::string("alpha")));
+    EXPECT_EQ(set.rank(std::string_view("charlie")), 2u);
+
+    ASSERT_TRUE(set.erase(std::string_view("alpha")));
+    ASSERT_TRUE(set.erase(std::string_view("echo")));
+    ASSERT_TRUE(set.erase(std::string_view("delta")));
+    EXPECT_TRUE(set.is_inline());
+    EXPECT_EQ(*set.select(0), "bravo");
+    EXPECT_EQ(set.distance(std::string_view("a"), std::string_view("z")), 2u);
+    EXPECT_TRUE(set.is_valid());
+}
+
+TEST(RBAdaptiveTest, StoresOnlyOneRepresentation) {
+    using Set = rb::AdaptiveSet<int, 64>;
+    EXPECT_LT(sizeof(Set), sizeof(std::array<int, 64>) + sizeof(rb::Tree<int>));
+}
+
+TEST(RBAdaptiveTest, InlineRankComparesMixedSignByValue) {
+    rb::AdaptiveSet<int, 8, rb::ThreeWayLess> set;
+    ASSERT_TRUE(set.insert(-1));
+    ASSERT_TRUE(set.insert(5));
+    ASSERT_TRUE(set.is_inline());
+    EXPECT_EQ(set.rank(0u), 1u);
+    EXPECT_EQ(set.rank(6u), 2u);
+    EXPECT_EQ(set.distance(0u, 10u), 1u);
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <set>
+#include <utility>
+
+#include "rb_tree.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+template <typename Tree>
+void FillRandomly(Tree& tree, std::set<long long>& reference, unsigned seed) {
+    std::mt19937 rng{seed};
+    std::uniform_int_distribution<long long> value_dist(-500, 500);
+    for (int i = 0; i < 2000; ++i) {
+        const long long value = value_dist(rng);
+        if (i % 3 == 2) {
+            EXPECT_EQ(tree.erase(value), reference.erase(value) == 1);
+        } else {
+            EXPECT_EQ(tree.insert(value), reference.insert(value).second);
+        }
+    }
+}
+
+} // namespace
+
+TEST(RBTreeAugmentTest, RangeSumMatchesBruteForce) {
+    rb::Tree<long long, rb::SumAugment<long long>> tree;
+    std::set<long long> reference;
+    FillRandomly(tree, reference, 7);
+    ASSERT_TRUE(tree.is_valid());
+
+    std::mt19937 rng{11};
+    std::uniform_int_distribution<long long> bound_dist(-600, 600);
+    for (int i = 0; i < 500; ++i) {
+        const long long left = bound_dist(rng);
+        const long long right = bound_dist(rng);
+        long long expected = 0;
+        for (long long value : reference) {
+            if (left <= value && value <= right) {
+                expected += value;
+            }
+        }
+        EXPECT_EQ(tree.aggregate(left, right), expected);
+    }
+
+    long long total = 0;
+    for (long long value : reference) {
+        total += value;
+    }
+    EXPECT_EQ(tree.aggregate(), total);
+}
+
+TEST(RBTreeAugmentTest, RangeMinMaxAndCount) {
+    rb::Tree<long long, rb::MinAugment<long long>> min_tree;
+    rb::Tree<long long, rb::MaxAugment<long long>> max_tree;
+    rb::Tree<long long, rb::CountAugment<long long>> count_tree;
+    std::set<long long> reference;
+    FillRandomly(min_tree, reference, 3);
+    reference.clear();
+    FillRandomly(max_tree, reference, 3);
+    reference.clear();
+    FillRandomly(count_tree, reference, 3);
+
+    for (long long left = -550; left <= 550; left += 37) {
+        for (long long right = left; right <= 550; right += 53) {
+            const auto first = reference.lower_bound(left);
+            const auto last = reference.upper_bound(right);
+            const auto count =
+                static_cast<std::size_t>(std::distance(first, last));
+            EXPECT_EQ(count_tree.aggregate(left, right), count);
+            if (count == 0) {
+                continue;
+            }
+            EXPECT_EQ(min_tree.aggregate(left, right), *first);
+            EXPECT_EQ(max_tree.aggregate(left, right), *std::prev(last));
+        }
+    }
+}
+
+TEST(RBTreeAugmentTest, EmptyAndInvertedRangesYieldIdentity) {
+    rb::Tree<int, rb::SumAugment<int>> tree;
+    EXPECT_EQ(tree.aggregate(), 0);
+    EXPECT_EQ(tree.aggregate(0, 10), 0);
+
+    for (int i = 1; i <= 10; ++i) {
+        tree.insert(i);
+    }
+    EXPECT_EQ(tree.aggregate(7, 3), 0);
+    EXPECT_EQ(tree.aggregate(3, 7), 25);
+
+    rb::Tree<int, rb::SumAugment<int>> copy(tree);
+    EXPECT_TRUE(copy.erase(5));
+    EXPECT_EQ(copy.aggregate(3, 7), 20);
+    EXPECT_EQ(tree.aggregate(3, 7), 25);
+}
+
+TEST(RBTreeAugmentTest, ModifyRecomputesSummariesInPlace) {
+    struct WeightSum {
+        using summary_type = long long;
+        static summary_type identity() { return 0; }
+        static summary_type lift(const std::pair<int, long long>& entry) {
+            return entry.second;
+        }
+        static summary_type combine(summary_type lhs, summary_type rhs) {
+            return lhs + rhs;
+        }
+    };
+    rb::Tree<std::pair<int, long long>, WeightSum, rb::SelectFirst> tree;
+    for (int key = 0; key < 200; ++key) {
+        tree.insert({key, 1});
+    }
+
+    EXPECT_TRUE(tree.modify(50, [](auto& entry) { entry.second = 100; }));
+    EXPECT_FALSE(tree.modify(500, [](auto& entry) { entry.second = 7; }));
+    EXPECT_TRUE(tree.is_valid());
+    EXPECT_EQ(tree.aggregate(0, 199), 299);
+    EXPECT_EQ(tree.aggregate(0, 49), 50);
+    EXPECT_EQ(tree.aggregate(50, 50), 100);
+    EXPECT_EQ(tree.find(50)->second, 100);
+}
@@ -1,7 +1,13 @@
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <numeric>
 #include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "rb_tree.hpp"
@@ -44,3 +50,338 @@ TEST(RBTreeBalanceTest, InsertEraseMaintainsBalance) {
     EXPECT_TRUE(tree.is_valid());
     EXPECT_TRUE(tree.empty());
 }
+
+TEST(RBTreeBalanceTest, CompactCountersKeepRanks) {
+    using CompactTree =
+        rb::Tree<int, rb::NoAugment, rb::IdentityKey, rb::ThreeWayLess,
+                 rb::CompactNodeTraits>;
+    static_assert(
+        sizeof(rb::Node<long long, rb::NoAugment, rb::CompactNodeTraits>) <
+        sizeof(rb::Node<long long>));
+
+    CompactTree tree;
+    std::vector<int> values(300);
+    std::iota(values.begin(), values.end(), 0);
+    std::mt19937 rng{777};
+    std::shuffle(values.begin(), values.end(), rng);
+    for (int value : values) {
+        ASSERT_TRUE(tree.insert(value));
+    }
+    for (int value = 0; value < 300; value += 3) {
+        ASSERT_TRUE(tree.erase(value));
+    }
+
+    EXPECT_TRUE(tree.is_valid());
+    EXPECT_EQ(tree.size(), 200u);
+    EXPECT_EQ(tree.distance(0, 299), 200u);
+    EXPECT_EQ(tree.rank(150), 100u);
+    EXPECT_EQ(*tree.select(0), 1);
+}
+
+TEST(RBTreeBalanceTest, UncountedTreeStaysBalanced) {
+    using PlainSet =
+        rb::Tree<int, rb::NoAugment, rb::IdentityKey, rb::ThreeWayLess,
+                 rb::UncountedNodes>;
+    static_assert(sizeof(rb::Node<int, rb::NoAugment, rb::UncountedNodes>) <
+                  sizeof(rb::Node<int>));
+
+    PlainSet tree;
+    std::vector<int> values(500);
+    std::iota(values.begin(), values.end(), 0);
+    std::mt19937 rng{99};
+    std::shuffle(values.begin(), values.end(), rng);
+    for (int value : values) {
+        ASSERT_TRUE(tree.insert(value));
+    }
+    EXPECT_FALSE(tree.insert(values.front()));
+    EXPECT_EQ(tree.size(), values.size());
+
+    std::shuffle(values.begin(), values.end(), rng);
+    for (std::size_t i = 0; i < values.size() / 2; ++i) {
+        ASSERT_TRUE(tree.erase(values[i]));
+    }
+    EXPECT_TRUE(tree.is_valid());
+    EXPECT_EQ(tree.size(), values.size() / 2);
+    EXPECT_EQ(*tree.lower_bound(values.back()), values.back());
+
+    PlainSet copy(tree);
+    EXPECT_EQ(copy.size(), tree.size());
+    EXPECT_TRUE(copy.is_valid());
+}
+
+TEST(RBTreeBalanceTest, ParallelBulkLoadBuildsValidTree) {
+    std::mt19937 rng{4096};
+    for (std::size_t count : {0u, 1u, 2u, 3u, 7u, 8u, 100u, 1000u, 70000u}) {
+        std::uniform_int_distribution<int> value_dist(
+            -static_cast<int>(count), static_cast<int>(count));
+        std::vector<int> values(count);
+        for (int& value : values) {
+            value = value_dist(rng);
+        }
+
+        for (unsigned threads : {1u, 3u, 8u}) {
+            auto tree = rb::Tree<int>::from_unsorted(values.begin(),
+                                                     values.end(), threads);
+            ASSERT_TRUE(tree.is_valid()) << count << " keys, " << threads;
+
+            std::vector<int> expected = values;
+            std::sort(expected.begin(), expected.end());
+            expected.erase(std::unique(expected.begin(), expected.end()),
+                           expected.end());
+            ASSERT_EQ(tree.size(), expected.size());
+            ASSERT_TRUE(std::equal(tree.begin(), tree.end(),
+                                   expected.begin(), expected.end()));
+            if (!expected.empty()) {
+                EXPECT_EQ(tree.distance(expected.front(), expected.back()),
+                          expected.size());
+            }
+
+            // Дерево остаётся рабочим после сборки.
+            tree.insert(static_cast<int>(count) + 1);
+            tree.erase(expected.empty() ? 0 : expected[expected.size() / 2]);
+            EXPECT_TRUE(tree.is_valid());
+        }
+    }
+}
+
+namespace {
+
+// Значение, перенос которого бросает исключение на чужом потоке, пока
+// armed; live считает живые экземпляры, чтобы заметить утечки.
+struct Fragile {
+    static std::atomic<int> live;
+    static std::atomic<bool> armed;
+    static std::thread::id home;
+
+    Fragile(int v = 0) : value(v) { ++live; }
+    Fragile(const Fragile& other) : value(other.value) { ++live; }
+    Fragile(Fragile&& other) : value(other.value) {
+        if (armed && std::this_thread::get_id() != home) {
+            throw std::runtime_error("move on a worker thread");
+        }
+        ++live;
+    }
+    Fragile& operator=(const Fragile&) = default;
+    Fragile& operator=(Fragile&&) = default;
+    ~Fragile() { --live; }
+
+    bool operator<(const Fragile& other) const { return value < other.value; }
+
+    int value;
+};
+
+std::atomic<int> Fragile::live{0};
+std::atomic<bool> Fragile::armed{false};
+std::thread::id Fragile::home;
+
+// Компаратор, который бросает исключение после limit сравнений.
+struct ThrowingLess {
+    std::shared_ptr<std::atomic<int>> calls;
+    int limit;
+
+    bool operator()(int lhs, int rhs) const {
+        if (++*calls > limit) {
+            throw std::runtime_error("comparison limit");
+        }
+        return lhs < rhs;
+    }
+};
+
+} // namespace
+
+TEST(RBTreeBalanceTest, BulkLoadPropagatesWorkerExceptions) {
+    // Небольшой вход сортируется в вызывающем потоке, а верхние
+    // поддеревья строятся на отдельных: исключение летит оттуда.
+    std::vector<Fragile> values;
+    for (int i = 0; i < 1000; ++i) {
+        values.emplace_back(i);
+    }
+    const int before = Fragile::live;
+    Fragile::home = std::this_thread::get_id();
+    Fragile::armed = true;
+    EXPECT_THROW(rb::Tree<Fragile>::from_unsorted(values.begin(), values.end(), 4),
+                 std::runtime_error);
+    Fragile::armed = false;
+    EXPECT_EQ(Fragile::live, before);
+
+    // Параллельная сортировка: компаратор бросает на рабочих потоках.
+    std::vector<int> keys(1 << 16);
+    std::iota(keys.rbegin(), keys.rend(), 0);
+    using Throwing = rb::Tree<int, rb::NoAugment, rb::IdentityKey, ThrowingLess>;
+    const ThrowingLess less{std::make_shared<std::atomic<int>>(0), 50000};
+    EXPECT_THROW(Throwing::from_unsorted(keys.begin(), keys.end(), 4, less),
+                 std::runtime_error);
+}
+
+TEST(RBTreeBalanceTest, BulkLoadKeepsAugmentationAndOrder) {
+    std::vector<long long> values(50000);
+    std::mt19937 rng{17};
+    std::uniform_int_distribution<long long> value_dist(0, 1000);
+    for (auto& value : values) {
+        value = value_dist(rng);
+    }
+
+    using SumTree = rb::Tree<long long, rb::SumAugment<long long>>;
+    const auto tree = SumTree::from_unsorted(values.begin(), values.end(), 4);
+    ASSERT_TRUE(tree.is_valid());
+    ASSERT_EQ(tree.size(), 1001u);
+    EXPECT_EQ(tree.aggregate(), 1000LL * 1001 / 2);
+    EXPECT_EQ(tree.aggregate(10LL, 20LL), 165);
+}
+
+TEST(RBTreeBalanceTest, ParallelValidationAgreesWithSequential) {
+    rb::Tree<int, rb::SumAugment<int>> tree;
+    rb::Tree<int, rb::NoAugment, rb::IdentityKey, rb::ThreeWayLess,
+             rb::UncountedNodes>
+        uncounted;
+    EXPECT_TRUE(tree.is_valid(4));
+
+    std::mt19937 rng{2718};
+    std::uniform_int_distribution<int> value_dist(0, 50000);
+    for (int step = 0; step < 40000; ++step) {
+        const int value = value_dist(rng);
+        if (step % 3 == 0) {
+            tree.erase(value);
+            uncounted.erase(value);
+        } else {
+            tree.insert(value);
+            uncounted.insert(value);
+        }
+        if (step % 4000 == 0) {
+            for (unsigned threads : {1u, 2u, 5u, 16u}) {
+                ASSERT_TRUE(tree.is_valid(threads));
+                ASSERT_TRUE(uncounted.is_valid(threads));
+            }
+        }
+    }
+    EXPECT_TRUE(tree.is_valid());
+    EXPECT_TRUE(tree.is_valid(0));
+    EXPECT_TRUE(uncounted.is_valid(0));
+}
+
+TEST(RBTreeBalanceTest, BatchedQueriesMatchSingleQueries) {
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> dist(-5000, 5000);
+    rb::Tree<int> tree;
+    for (int i = 0; i < 3000; ++i) {
+        tree.insert(dist(rng));
+    }
+
+    // Больше запросов, чем batch_group, чтобы слоты переиспользовались.
+    std::vector<int> keys;
+    std::vector<std::pair<int, int>> ranges;
+    for (int i = 0; i < 500; ++i) {
+        keys.push_back(dist(rng));
+        ranges.emplace_back(dist(rng), dist(rng));
+    }
+
+    const auto ranks = tree.rank_batch(keys);
+    const auto bounds = tree.lower_bound_batch(keys);
+    const auto distances = tree.distance_batch(ranges);
+    ASSERT_EQ(ranks.size(), keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(ranks[i], tree.rank(keys[i]));
+        EXPECT_EQ(bounds[i], tree.lower_bound(keys[i]));
+        EXPECT_EQ(distances[i], tree.distance(ranges[i].first, ranges[i].second));
+    }
+
+    const rb::Tree<int> empty;
+    EXPECT_EQ(empty.rank_batch(keys), std::vector<std::size_t>(keys.size(), 0));
+    EXPECT_TRUE(tree.rank_batch(std::vector<int>{}).empty());
+}
+
+namespace {
+
+// Ключ, считающий приведения из int.
+struct Converted {
+    static inline int conversions = 0;
+
+    Converted() = default;
+    Converted(int v) : value(v) { ++conversions; }
+
+    bool operator<(const Converted& other) const { return value < other.value; }
+
+    int value = 0;
+};
+
+} // namespace
+
+TEST(RBTreeBalanceTest, BatchedQueriesConvertEachKeyOnce) {
+    rb::Tree<Converted> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(Converted(2 * i));
+    }
+    const std::vector<int> keys = {-1, 0, 7, 500, 1998, 5000};
+    const std::vector<std::pair<int, int>> ranges = {{0, 10}, {7, 3}, {-5, 5000}};
+
+    Converted::conversions = 0;
+    const auto ranks = tree.rank_batch(keys);
+    const auto bounds = tree.lower_bound_batch(keys);
+    const auto distances = tree.distance_batch(ranges);
+    EXPECT_EQ(Converted::conversions,
+              static_cast<int>(2 * keys.size() + 2 * ranges.size()));
+
+    EXPECT_EQ(ranks, (std::vector<std::size_t>{0, 0, 4, 250, 999, 1000}));
+    EXPECT_EQ(bounds[2]->value, 8);
+    EXPECT_EQ(bounds[5], tree.end());
+    EXPECT_EQ(distances, (std::vector<std::size_t>{6, 0, 1000}));
+}
+
+TEST(RBTreeBalanceTest, FingerSearchMatchesRootSearch) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> dist(0, 20000);
+    rb::Tree<int> tree;
+    for (int i = 0; i < 4000; ++i) {
+        tree.insert(dist(rng));
+    }
+
+    auto finger = tree.finger();
+    std::uniform_int_distribution<int> step(-40, 40);
+    int key = 10000;
+    for (int i = 0; i < 3000; ++i) {
+        // Чередуем короткие шаги с редкими прыжками через всё дерево.
+        key = i % 100 == 0 ? dist(rng) - 100 : key + step(rng);
+        const auto lower = finger.lower_bound(key);
+        EXPECT_EQ(lower.base(), tree.lower_bound(key));
+        EXPECT_EQ(lower.rank(), tree.rank(key));
+        EXPECT_EQ(finger.position(), lower);
+
+        const auto upper = finger.upper_bound(key);
+        EXPECT_EQ(upper.base(), tree.upper_bound(key));
+        EXPECT_EQ(upper.rank(), tree.rank(key) + (tree.contains(key) ? 1 : 0));
+    }
+
+    const rb::Tree<int> empty;
+    auto empty_finger = empty.finger();
+    EXPECT_EQ(empty_finger.lower_bound(1).base(), empty.end());
+    EXPECT_EQ(empty_finger.position().rank(), 0u);
+}
+
+TEST(RBTreeBalanceTest, RankedIteratorsTrackRank) {
+    rb::Tree<int> tree;
+    for (int i = 0; i < 300; ++i) {
+        tree.insert(i * 3);
+    }
+
+    for (int key = -2; key < 905; key += 7) {
+        const auto lower = tree.ranked_lower_bound(key);
+        const auto upper = tree.ranked_upper_bound(key + 40);
+        EXPECT_EQ(lower.base(), tree.lower_bound(key));
+        EXPECT_EQ(lower.rank(), tree.rank(key));
+        EXPECT_EQ(upper.base(), tree.upper_bound(key + 40));
+        EXPECT_EQ(static_cast<std::size_t>(upper - lower),
+                  tree.distance(key, key + 40));
+    }
+
+    std::size_t expected = 0;
+    for (auto it = tree.ranked_begin(); it != tree.ranked_end(); ++it) {
+        EXPECT_EQ(it.rank(), expected++);
+        EXPECT_EQ(*it, static_cast<int>(it.rank()) * 3);
+    }
+    auto last = tree.ranked_end();
+    --last;
+    EXPECT_EQ(last.rank(), tree.size() - 1);
+    EXPECT_EQ(tree.ranked_select(10).rank(), 10u);
+    EXPECT_EQ(*tree.ranked_select(10), 30);
+    EXPECT_EQ(tree.ranked_select(tree.size()), tree.ranked_end());
+}
@@ -0,0 +1,59 @@
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <set>
+
+#include "rb_bitvector.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(RBBitvectorTest, RandomUpdatesMatchStdSet) {
+    // Несколько суперблоков и неполное последнее слово.
+    const std::size_t universe = 40000 + 37;
+    rb::BitvectorSet set(universe);
+    std::set<unsigned> reference;
+    std::mt19937 rng{515};
+    std::uniform_int_distribution<unsigned> key_dist(0, universe - 1);
+
+    for (int step = 0; step < 20000; ++step) {
+        const unsigned key = key_dist(rng);
+        if (rng() % 4 == 0) {
+            ASSERT_EQ(set.erase(key), reference.erase(key) == 1);
+        } else {
+            ASSERT_EQ(set.insert(key), reference.insert(key).second);
+        }
+    }
+    ASSERT_EQ(set.size(), reference.size());
+
+    for (int query = 0; query < 2000; ++query) {
+        const unsigned key = key_dist(rng);
+        const auto expected = static_cast<std::size_t>(std::distance(
+            reference.begin(), reference.lower_bound(key)));
+        ASSERT_EQ(set.rank(key), expected);
+        ASSERT_EQ(set.contains(key), reference.count(key) == 1);
+    }
+    EXPECT_EQ(set.rank(universe), set.size());
+
+    std::size_t index = 0;
+    for (unsigned key : reference) {
+        ASSERT_EQ(set.select(index++), key);
+    }
+    EXPECT_FALSE(set.select(reference.size()).has_value());
+}
+
+TEST(RBBitvectorTest, DistanceClampsToUniverse) {
+    rb::BitvectorSet set(100);
+    for (unsigned key : {0u, 5u, 63u, 64u, 99u}) {
+        ASSERT_TRUE(set.insert(key));
+    }
+    EXPECT_FALSE(set.insert(100));
+    EXPECT_FALSE(set.insert(5));
+
+    EXPECT_EQ(set.distance(0, 99), 5u);
+    EXPECT_EQ(set.distance(-10, 1000), 5u);
+    EXPECT_EQ(set.distance(63, 64), 2u);
+    EXPECT_EQ(set.distance(6, 62), 0u);
+    EXPECT_EQ(set.distance(64, 63), 0u);
+    EXPECT_EQ(set.distance(-5, -1), 0u);
+    EXPECT_EQ(set.rank(-1), 0u);
+}
@@ -29,3 +29,15 @@ TEST(RBTreeCliIterTest, HandlesDescendingBoundsAndInclusiveLeft) {
     EXPECT_EQ(output.str(), "0 0 0 0 0 0 0 2 0 3\n");
     EXPECT_TRUE(error.str().empty());
 }
+
+TEST(RBTreeCliIterTest, EraseSelectAndRankCommands) {
+    std::istringstream input(
+        "k 10 k 20 k 30 k 40 r 25 s 1 s 4 s 5 s 0 d 20 d 7 r 25 s 2 q 0 100 "
+        "d 10 d 30 d 40 s 1 r 5\n");
+    std::ostringstream output;
+    std::ostringstream error;
+
+    EXPECT_EQ(rb::run_cli_iter(input, output, error), 0);
+    EXPECT_EQ(output.str(), "2 10 40 none none 1 30 3 none 0\n");
+    EXPECT_TRUE(error.str().empty());
+}
@@ -1,6 +1,8 @@
 #include "rb_tree_cli.hpp"
 
+#include <random>
 #include <sstream>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -29,3 +31,136 @@ TEST(RBTreeCliTest, HandlesDescendingBoundsAndInclusiveLeft) {
     EXPECT_EQ(output.str(), "0 0 0 0 0 0 0 2 0 3\n");
     EXPECT_TRUE(error.str().empty());
 }
+
+TEST(RBTreeCliTest, BoundedEnginesMatchTree) {
+    const char* commands =
+        "k 10 q 2 7 q 3 9 k 1 k 2 k 0 k 6 q 7 2 k 10 q 3 1 q 5 3 q 9 4 k 2 q 7 8 "
+        "k 2 k 3 k 1 q 2 3 q 6 1 q 2 9 q -5 100 q 0 0\n";
+    std::istringstream tree_input(commands);
+    std::ostringstream tree_output;
+    std::ostringstream error;
+    EXPECT_EQ(rb::run_cli(tree_input, tree_output, error), 0);
+
+    for (rb::Engine engine : {rb::Engine::BITVECTOR, rb::Engine::FENWICK}) {
+        rb::CliOptions options;
+        options.engine = engine;
+        options.max_key = 64;
+
+        std::istringstream input(commands);
+        std::ostringstream output;
+        EXPECT_EQ(rb::run_cli(input, output, error, options), 0);
+        EXPECT_EQ(output.str(), tree_output.str());
+    }
+    EXPECT_TRUE(error.str().empty());
+}
+
+TEST(RBTreeCliTest, ParsesEngineOptions) {
+    const char* args[] = {"rb_tree_cli", "--engine=bitvector", "--max=100"};
+    rb::CliOptions options;
+    std::ostringstream error;
+    ASSERT_TRUE(rb::parse_cli_options(3, const_cast<char**>(args), options, error));
+    EXPECT_EQ(options.engine, rb::Engine::BITVECTOR);
+    EXPECT_EQ(options.max_key, 100);
+
+    std::istringstream input("k 5 k 101\n");
+    std::ostringstream output;
+    EXPECT_EQ(rb::run_cli(input, output, error, options), 1);
+    EXPECT_EQ(error.str(), "Key out of range: 101\n");
+
+    const char* bad_args[] = {"rb_tree_cli", "--engine=trie"};
+    std::ostringstream bad_error;
+    EXPECT_FALSE(rb::parse_cli_options(2, const_cast<char**>(bad_args), options, bad_error));
+    EXPECT_EQ(bad_error.str(), "Unknown engine: trie\n");
+}
+
+TEST(RBTreeCliTest, EraseSelectAndRankCommands) {
+    const char* commands =
+        "k 10 k 20 k 30 k 40 r 25 s 1 s 4 s 5 s 0 d 20 d 7 r 25 s 2 q 0 100 "
+        "d 10 d 30 d 40 s 1 r 5\n";
+    const char* expected = "2 10 40 none none 1 30 3 none 0\n";
+
+    std::istringstream input(commands);
+    std::ostringstream output;
+    std::ostringstream error;
+    EXPECT_EQ(rb::run_cli(input, output, error), 0);
+    EXPECT_EQ(output.str(), expected);
+
+    for (rb::Engine engine : {rb::Engine::BITVECTOR, rb::Engine::FENWICK}) {
+        rb::CliOptions options;
+        options.engine = engine;
+        options.max_key = 64;
+
+        std::istringstream bounded_input(commands);
+        std::ostringstream bounded_output;
+        EXPECT_EQ(rb::run_cli(bounded_input, bounded_output, error, options), 0);
+        EXPECT_EQ(bounded_output.str(), expected);
+    }
+    EXPECT_TRUE(error.str().empty());
+
+    std::istringstream broken("k 1 s x\n");
+    std::ostringstream broken_output;
+    EXPECT_EQ(rb::run_cli(broken, broken_output, error), 1);
+    EXPECT_EQ(error.str(), "Failed to read select index\n");
+}
+
+TEST(RBTreeCliTest, ParallelQueriesKeepInputOrder) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> key_dist(0, 1000);
+    std::uniform_int_distribution<int> op_dist(0, 99);
+    std::string commands;
+    for (int i = 0; i < 30000; ++i) {
+        const int op = op_dist(rng);
+        const int key = key_dist(rng);
+        if (i < 2000 || op < 3) {
+            commands += "k " + std::to_string(key) + ' ';
+        } else if (op < 5) {
+            commands += "d " + std::to_string(key) + ' ';
+        } else if (op < 70) {
+            commands += "q " + std::to_string(key) + ' ' +
+                        std::to_string(key_dist(rng)) + ' ';
+        } else if (op < 85) {
+            commands += "s " + std::to_string(key) + ' ';
+        } else {
+            commands += "r " + std::to_string(key) + ' ';
+        }
+        // Длинная серия запросов, которая выполняется на нескольких потоках.
+        if (i == 10000) {
+            for (int j = 0; j < 10000; ++j) {
+                commands += "q 0 " + std::to_string(key_dist(rng)) + ' ';
+            }
+        }
+    }
+
+    const char* args[] = {"rb_tree_cli", "--threads=4"};
+    rb::CliOptions parallel;
+    std::ostringstream error;
+    ASSERT_TRUE(rb::parse_cli_options(2, const_cast<char**>(args), parallel, error));
+    EXPECT_EQ(parallel.threads, 4u);
+
+    for (rb::Engine engine :
+         {rb::Engine::TREE, rb::Engine::BITVECTOR, rb::Engine::FENWICK}) {
+        rb::CliOptions sequential;
+        sequential.engine = engine;
+        sequential.max_key = 1000;
+        parallel.engine = engine;
+        parallel.max_key = 1000;
+
+        std::istringstream sequential_input(commands);
+        std::ostringstream sequential_output;
+        EXPECT_EQ(rb::run_cli(sequential_input, sequential_output, error, sequential), 0);
+
+        std::istringstream parallel_input(commands);
+        std::ostringstream parallel_output;
+        EXPECT_EQ(rb::run_cli(parallel_input, parallel_output, error, parallel), 0);
+        EXPECT_EQ(parallel_output.str(), sequential_output.str());
+    }
+    EXPECT_TRUE(error.str().empty());
+
+    for (const char* value : {"-2", "0", "257", "100000000000", "many"}) {
+        const std::string arg = std::string("--threads=") + value;
+        const char* bad_args[] = {"rb_tree_cli", arg.c_str()};
+        std::ostringstream bad_error;
+        EXPECT_FALSE(rb::parse_cli_options(2, const_cast<char**>(bad_args), parallel, bad_error));
+        EXPECT_EQ(bad_error.str(), "Invalid --threads value: " + std::string(value) + '\n');
+    }
+}
@@ -0,0 +1,60 @@
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <set>
+
+#include "rb_fenwick.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(RBFenwickTest, RandomUpdatesMatchStdSet) {
+    const std::size_t universe = 5000;
+    rb::FenwickSet set(universe);
+    std::set<unsigned> reference;
+    std::mt19937 rng{606};
+    std::uniform_int_distribution<unsigned> key_dist(0, universe - 1);
+
+    for (int step = 0; step < 8000; ++step) {
+        const unsigned key = key_dist(rng);
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(set.erase(key), reference.erase(key) == 1);
+        } else {
+            ASSERT_EQ(set.insert(key), reference.insert(key).second);
+        }
+    }
+    ASSERT_EQ(set.size(), reference.size());
+
+    for (int query = 0; query < 1000; ++query) {
+        const unsigned key = key_dist(rng);
+        const auto lower = reference.lower_bound(key);
+        ASSERT_EQ(set.rank(key), static_cast<std::size_t>(
+                                     std::distance(reference.begin(), lower)));
+        const auto found = set.lower_bound(key);
+        ASSERT_EQ(found.has_value(), lower != reference.end());
+        if (found) {
+            ASSERT_EQ(*found, *lower);
+        }
+    }
+
+    std::size_t index = 0;
+    for (unsigned key : reference) {
+        ASSERT_EQ(set.select(index++), key);
+    }
+    EXPECT_FALSE(set.select(index).has_value());
+}
+
+TEST(RBFenwickTest, DistanceClampsToUniverse) {
+    rb::FenwickSet set(11);
+    for (unsigned key : {0u, 3u, 8u, 10u}) {
+        ASSERT_TRUE(set.insert(key));
+    }
+    EXPECT_FALSE(set.insert(11));
+
+    EXPECT_EQ(set.distance(0, 10), 4u);
+    EXPECT_EQ(set.distance(-7, 50), 4u);
+    EXPECT_EQ(set.distance(3, 8), 2u);
+    EXPECT_EQ(set.distance(4, 7), 0u);
+    EXPECT_EQ(set.distance(8, 3), 0u);
+    EXPECT_EQ(set.distance(-9, -1), 0u);
+    EXPECT_EQ(*set.select(3), 10u);
+}
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "rb_interval_tree.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using Interval = rb::Interval<int>;
+
+std::vector<Interval> brute_overlaps(const std::vector<Interval>& intervals,
+                                     int lo,
+                                     int hi) {
+    std::vector<Interval> result;
+    for (const auto& interval : intervals) {
+        if (interval.lo <= hi && lo <= interval.hi) {
+            result.push_back(interval);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.lo < rhs.lo || (lhs.lo == rhs.lo && lhs.hi < rhs.hi);
+    });
+    return result;
+}
+
+} // namespace
+
+TEST(RBIntervalTreeTest, MatchesLinearScan) {
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> start(0, 2000);
+    std::uniform_int_distribution<int> length(0, 120);
+    rb::IntervalTree<int> tree;
+    std::vector<Interval> intervals;
+
+    for (int i = 0; i < 1500; ++i) {
+        const int lo = start(rng);
+        const int hi = lo + length(rng);
+        const bool inserted = tree.insert(lo, hi);
+        const bool fresh = std::find(intervals.begin(), intervals.end(),
+                                     Interval{lo, hi}) == intervals.end();
+        ASSERT_EQ(inserted, fresh);
+        if (fresh) {
+            intervals.push_back({lo, hi});
+        }
+        if (i % 3 == 0) {
+            const auto victim = intervals[static_cast<std::size_t>(
+                rng() % intervals.size())];
+            ASSERT_TRUE(tree.erase(victim.lo, victim.hi));
+            intervals.erase(std::find(intervals.begin(), intervals.end(), victim));
+        }
+    }
+    ASSERT_TRUE(tree.is_valid());
+    ASSERT_EQ(tree.size(), intervals.size());
+
+    for (int i = 0; i < 300; ++i) {
+        const int lo = start(rng) - 100;
+        const int hi = lo + length(rng) / 4;
+        const auto expected = brute_overlaps(intervals, lo, hi);
+        EXPECT_EQ(tree.overlaps(lo, hi), expected);
+        EXPECT_EQ(tree.count_overlaps(lo, hi), expected.size());
+        EXPECT_EQ(tree.count_stabbing(lo), brute_overlaps(intervals, lo, lo).size());
+    }
+    EXPECT_EQ(tree.count_overlaps(10, 5), 0u);
+}
+
+TEST(RBIntervalTreeTest, StabbingPointsAndEdges) {
+    rb::IntervalTree<int> tree;
+    EXPECT_TRUE(tree.stab(0).empty());
+    EXPECT_TRUE(tree.insert(1, 5));
+    EXPECT_TRUE(tree.insert(1, 3));
+    EXPECT_TRUE(tree.insert(5, 5));
+    EXPECT_TRUE(tree.insert(7, 9));
+    EXPECT_FALSE(tree.insert(1, 3));
+
+    EXPECT_EQ(tree.stab(5), (std::vector<Interval>{{1, 5}, {5, 5}}));
+    EXPECT_EQ(tree.count_stabbing(6), 0u);
+    EXPECT_EQ(tree.count_overlaps(3, 7), 4u);
+    EXPECT_TRUE(tree.contains(5, 5));
+    EXPECT_FALSE(tree.erase(2, 3));
+    EXPECT_TRUE(tree.erase(1, 5));
+    EXPECT_TRUE(tree.stab(4).empty());
+    EXPECT_EQ(tree.stab(2), (std::vector<Interval>{{1, 3}}));
+    EXPECT_TRUE(tree.is_valid());
+}
@@ -0,0 +1,72 @@
+#include <cstddef>
+#include <map>
+#include <random>
+#include <string>
+
+#include "rb_map.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(RBMapTest, FindReturnsMutableValue) {
+    rb::Map<int, std::string> map;
+    EXPECT_TRUE(map.insert(2, "two"));
+    EXPECT_TRUE(map.insert(1, "one"));
+    EXPECT_FALSE(map.insert(2, "deux"));
+
+    std::string* value = map.find(2);
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, "two");
+    *value = "zwei";
+    EXPECT_EQ(*map.find(2), "zwei");
+    EXPECT_EQ(map.find(3), nullptr);
+
+    map[3] += "drei";
+    EXPECT_EQ(*map.find(3), "drei");
+    EXPECT_EQ(map.size(), 3u);
+    EXPECT_TRUE(map.is_valid());
+}
+
+TEST(RBMapTest, SelectRankAndDistanceMatchStdMap) {
+    rb::Map<int, int> map;
+    std::map<int, int> reference;
+
+    std::mt19937 rng{2024};
+    std::uniform_int_distribution<int> key_dist(0, 300);
+    for (int i = 0; i < 1500; ++i) {
+        const int key = key_dist(rng);
+        if (i % 4 == 3) {
+            EXPECT_EQ(map.erase(key), reference.erase(key) == 1);
+        } else {
+            map[key] += i;
+            reference[key] += i;
+        }
+    }
+    ASSERT_TRUE(map.is_valid());
+    ASSERT_EQ(map.size(), reference.size());
+
+    std::size_t index = 0;
+    for (const auto& [key, value] : reference) {
+        const auto entry = map.select(index);
+        ASSERT_NE(entry, map.end());
+        EXPECT_EQ(entry->first, key);
+        EXPECT_EQ(entry->second, value);
+        EXPECT_EQ(map.rank(key), index);
+        ++index;
+    }
+
+    EXPECT_EQ(map.select(map.size()), map.end());
+    EXPECT_EQ(map.select(static_cast<std::size_t>(-1)), map.end());
+    const rb::Map<int, int> empty;
+    EXPECT_EQ(empty.select(0), empty.end());
+
+    map[map.select(0)->first] = -7;
+    EXPECT_EQ(*map.find(reference.begin()->first), -7);
+
+    for (int left = -10; left <= 310; left += 13) {
+        for (int right = left; right <= 310; right += 29) {
+            const auto expected = static_cast<std::size_t>(std::distance(
+                reference.lower_bound(left), reference.upper_bound(right)));
+            EXPECT_EQ(map.distance(left, right), expected);
+        }
+    }
+}
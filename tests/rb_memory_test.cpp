@@ -1,5 +1,8 @@
 #include "rb_tree.hpp"
 
+#include <cstddef>
+#include <memory_resource>
+
 #include <gtest/gtest.h>
 
 namespace {
@@ -43,6 +46,33 @@ void ResetCounters() {
     LifetimeTracker::destructions = 0;
 }
 
+// Считает блоки, выделенные через ресурс и ещё не возвращённые.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream) {}
+
+    std::ptrdiff_t live = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++live;
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        --live;
+        upstream_->deallocate(p, bytes, alignment);
+    }
+
+    std::pmr::memory_resource* upstream_;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
 } // namespace
 
 TEST(RBTreeMemoryTest, DestructionReleasesAllNodes) {
@@ -135,3 +165,153 @@ TEST(RBTreeMemoryTest, MoveAssignmentReleasesPreviousNodes) {
     EXPECT_TRUE(rhs.is_valid());
     EXPECT_GE(LifetimeTracker::destructions, 20);
 }
+
+TEST(RBTreeMemoryTest, NodesComeFromMemoryResource) {
+    ResetCounters();
+    CountingResource resource;
+    CountingResource other_resource;
+    {
+        rb::Tree<LifetimeTracker> tree(&resource);
+        for (int i = 0; i < 50; ++i) {
+            tree.insert(LifetimeTracker{i});
+        }
+        tree.erase(LifetimeTracker{7});
+        EXPECT_EQ(resource.live, 49);
+
+        // Копия не наследует ресурс, присваивание сохраняет свой.
+        rb::Tree<LifetimeTracker> copy(tree);
+        EXPECT_EQ(copy.memory_resource(), nullptr);
+        EXPECT_EQ(resource.live, 49);
+
+        rb::Tree<LifetimeTracker> target(&other_resource);
+        target = std::move(tree);
+        EXPECT_EQ(target.memory_resource(), &other_resource);
+        EXPECT_EQ(other_resource.live, 49);
+        EXPECT_TRUE(target.is_valid());
+
+        rb::Tree<LifetimeTracker> same(&resource);
+        same = std::move(tree);
+        EXPECT_EQ(resource.live, 49);
+        EXPECT_TRUE(tree.empty());
+
+        // Узел из дерева с другим ресурсом переносится в новый узел.
+        copy.insert(LifetimeTracker{1000});
+        EXPECT_TRUE(same.insert(copy.extract(LifetimeTracker{1000})).inserted);
+        EXPECT_EQ(resource.live, 50);
+        EXPECT_TRUE(same.is_valid());
+    }
+    EXPECT_EQ(resource.live, 0);
+    EXPECT_EQ(other_resource.live, 0);
+    EXPECT_EQ(LifetimeTracker::constructions, LifetimeTracker::destructions);
+}
+
+TEST(RBTreeMemoryTest, MonotonicArenaBacksWholeTree) {
+    CountingResource upstream;
+    {
+        std::pmr::monotonic_buffer_resource arena(1 << 16, &upstream);
+        rb::Tree<int> tree(&arena);
+        for (int i = 0; i < 10000; ++i) {
+            tree.insert(i);
+        }
+        tree.erase(5);
+        EXPECT_TRUE(tree.is_valid());
+        EXPECT_EQ(tree.size(), 9999u);
+        // Арена берёт у upstream несколько крупных блоков, а не узлы.
+        EXPECT_LT(upstream.live, 10);
+    }
+    EXPECT_EQ(upstream.live, 0);
+}
+
+TEST(RBTreeMemoryTest, PoolOverArenaReusesErasedNodes) {
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource arena(1 << 12, &upstream);
+    std::pmr::unsynchronized_pool_resource pool(&arena);
+    rb::Tree<int> tree(&pool);
+    for (int i = 0; i < 100; ++i) {
+        tree.insert(i);
+    }
+    const std::ptrdiff_t blocks = upstream.live;
+    // Чередование вставок и удалений, как k x / d x в CLI, не растит арену.
+    for (int i = 0; i < 100000; ++i) {
+        tree.insert(1000 + i);
+        tree.erase(1000 + i);
+    }
+    EXPECT_TRUE(tree.is_valid());
+    EXPECT_EQ(tree.size(), 100u);
+    EXPECT_EQ(upstream.live, blocks);
+}
+
+TEST(RBTreeMemoryTest, ReleaseWithResourceSkipsNodeWalk) {
+    // Память узлов живёт в арене, поэтому пропущенные deallocate не текут.
+    std::pmr::monotonic_buffer_resource arena;
+    CountingResource counting(&arena);
+    {
+        rb::Tree<int> tree(&counting, rb::release_nodes_with_resource);
+        for (int i = 0; i < 1000; ++i) {
+            tree.insert(i);
+        }
+        // erase по-прежнему возвращает узел ресурсу.
+        tree.erase(5);
+        EXPECT_EQ(counting.live, 999);
+
+        rb::Tree<int> other(&counting, rb::release_nodes_with_resource);
+        other.insert(1);
+        tree = std::move(other);
+        EXPECT_EQ(tree.size(), 1u);
+        EXPECT_EQ(counting.live, 1000);
+    }
+    EXPECT_EQ(counting.live, 1000);
+
+    CountingResource walked(&arena);
+    {
+        rb::Tree<int> tree(&walked);
+        for (int i = 0; i < 1000; ++i) {
+            tree.insert(i);
+        }
+    }
+    EXPECT_EQ(walked.live, 0);
+}
+
+TEST(RBTreeMemoryTest, NodeHandlesMoveWithoutCopies) {
+    ResetCounters();
+    rb::Tree<LifetimeTracker> source;
+    rb::Tree<LifetimeTracker> target;
+    for (int i = 0; i < 40; ++i) {
+        source.insert(LifetimeTracker{i});
+    }
+    for (int i = 30; i < 50; ++i) {
+        target.insert(LifetimeTracker{i});
+    }
+
+    auto handle = source.extract(LifetimeTracker{5});
+    ASSERT_FALSE(handle.empty());
+    EXPECT_EQ(handle.value().value, 5);
+    EXPECT_FALSE(source.contains(LifetimeTracker{5}));
+    EXPECT_TRUE(source.extract(LifetimeTracker{5}).empty());
+
+    // Ключ можно поменять, пока узел вне дерева.
+    handle.value().value = 100;
+    auto inserted = target.insert(std::move(handle));
+    EXPECT_TRUE(inserted.inserted);
+    EXPECT_TRUE(inserted.node.empty());
+    EXPECT_EQ(inserted.position->value, 100);
+
+    auto duplicate = target.insert(source.extract(source.begin()));
+    EXPECT_TRUE(duplicate.inserted);
+    duplicate = target.insert(source.extract(LifetimeTracker{31}));
+    EXPECT_FALSE(duplicate.inserted);
+    EXPECT_EQ(duplicate.node.value().value, 31);
+    EXPECT_EQ(duplicate.position->value, 31);
+
+    // Слияние переносит узлы, не создавая значений.
+    const int constructions = LifetimeTracker::constructions;
+    target.merge(source);
+    EXPECT_EQ(LifetimeTracker::constructions, constructions);
+    EXPECT_EQ(target.size(), 50u);
+    EXPECT_EQ(source.size(), 9u);
+    EXPECT_TRUE(source.is_valid());
+    EXPECT_TRUE(target.is_valid());
+    for (const auto& item : source) {
+        EXPECT_TRUE(item.value >= 30 && item.value < 40);
+    }
+}
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rb_index_storage.hpp"
+#include "rb_path_tree.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+template <typename TreeType>
+void expect_same_contents(const TreeType& tree,
+                          const std::set<int>& reference) {
+    ASSERT_EQ(tree.size(), reference.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(),
+                           reference.begin(), reference.end()));
+}
+
+} // namespace
+
+TEST(RBPathTreeTest, RandomInsertEraseMatchesStdSet) {
+    rb::PathTree<int> tree;
+    std::set<int> reference;
+    std::mt19937 rng{2024};
+    std::uniform_int_distribution<int> value_dist(0, 400);
+
+    for (int step = 0; step < 4000; ++step) {
+        const int value = value_dist(rng);
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(tree.erase(value), reference.erase(value) == 1);
+        } else {
+            ASSERT_EQ(tree.insert(value), reference.insert(value).second);
+        }
+        if (step % 200 == 0) {
+            ASSERT_TRUE(tree.is_valid());
+            expect_same_contents(tree, reference);
+        }
+    }
+    EXPECT_TRUE(tree.is_valid());
+    expect_same_contents(tree, reference);
+}
+
+TEST(RBPathTreeTest, RankQueriesMatchStdSet) {
+    rb::PathTree<int> tree;
+    std::set<int> reference;
+    std::vector<int> values(300);
+    std::iota(values.begin(), values.end(), 0);
+    std::mt19937 rng{99};
+    std::shuffle(values.begin(), values.end(), rng);
+    for (int value : values) {
+        if (value % 3 != 0) {
+            tree.insert(value * 2);
+            reference.insert(value * 2);
+        }
+    }
+
+    for (int key = -2; key < 610; key += 7) {
+        const auto expected_rank = static_cast<std::size_t>(std::distance(
+            reference.begin(), reference.lower_bound(key)));
+        EXPECT_EQ(tree.rank(key), expected_rank);
+
+        const int high = key + 40;
+        const auto expected_distance = static_cast<std::size_t>(std::distance(
+            reference.lower_bound(key), reference.upper_bound(high)));
+        EXPECT_EQ(tree.distance(key, high), expected_distance);
+        EXPECT_EQ(tree.distance(high, key), 0u);
+
+        const auto lower = tree.lower_bound(key);
+        const auto expected_lower = reference.lower_bound(key);
+        ASSERT_EQ(lower == tree.end(), expected_lower == reference.end());
+        if (lower != tree.end()) {
+            EXPECT_EQ(*lower, *expected_lower);
+            EXPECT_EQ(std::distance(lower, tree.end()),
+                      std::distance(expected_lower, reference.end()));
+        }
+    }
+
+    std::size_t index = 0;
+    for (int value : reference) {
+        const auto it = tree.select(index++);
+        ASSERT_NE(it, tree.end());
+        EXPECT_EQ(*it, value);
+    }
+    EXPECT_EQ(tree.select(reference.size()), tree.end());
+}
+
+TEST(RBPathTreeTest, IteratorsWalkBothWays) {
+    rb::PathTree<int> tree;
+    for (int value : {5, 1, 9, 3, 7, 2, 8}) {
+        tree.insert(value);
+    }
+
+    std::vector<int> backward;
+    for (auto it = tree.end(); it != tree.begin();) {
+        --it;
+        backward.push_back(*it);
+    }
+    EXPECT_EQ(backward, (std::vector<int>{9, 8, 7, 5, 3, 2, 1}));
+
+    auto it = tree.find(5);
+    ASSERT_NE(it, tree.end());
+    EXPECT_EQ(*++it, 7);
+    EXPECT_EQ(*--it, 5);
+    EXPECT_EQ(*--it, 3);
+    EXPECT_EQ(tree.find(4), tree.end());
+    EXPECT_EQ(*tree.upper_bound(5), 7);
+}
+
+TEST(RBPathTreeTest, IteratorsSpillDeepPathsToHeap) {
+    // Возрастающие вставки дают высоту около 2·log2(n): больше, чем
+    // итератор хранит в себе.
+    rb::IndexTree<int> tree;
+    const int count = 1 << 18;
+    for (int value = 0; value < count; ++value) {
+        tree.insert(value);
+    }
+    std::size_t height = 0;
+    std::vector<std::pair<std::uint32_t, std::size_t>> stack{{tree.root(), 1}};
+    while (!stack.empty()) {
+        const auto [node, depth] = stack.back();
+        stack.pop_back();
+        if (node == rb::IndexStorage<int>::nil()) {
+            continue;
+        }
+        height = std::max(height, depth);
+        stack.push_back({tree.storage().left(node), depth + 1});
+        stack.push_back({tree.storage().right(node), depth + 1});
+    }
+    ASSERT_GT(height, rb::IndexTree<int>::iterator_inline_depth);
+
+    int expected = 0;
+    for (int value : tree) {
+        ASSERT_EQ(value, expected++);
+    }
+    EXPECT_EQ(expected, count);
+    for (auto it = tree.end(); it != tree.begin();) {
+        ASSERT_EQ(*--it, --expected);
+    }
+    for (int value = 0; value < count; value += 997) {
+        auto it = tree.lower_bound(value);
+        ASSERT_EQ(*it, value);
+        ASSERT_EQ(*++it, value + 1);
+        ASSERT_EQ(*tree.find(value + 1), value + 1);
+    }
+}
+
+TEST(RBPathTreeTest, CopyAndMoveKeepContents) {
+    using Words = rb::PathTree<std::string, rb::ThreeWayLess>;
+    Words tree;
+    for (const char* word : {"pear", "apple", "plum", "fig"}) {
+        tree.insert(word);
+    }
+
+    Words copy(tree);
+    copy.erase(std::string_view("apple"));
+    EXPECT_TRUE(tree.contains(std::string_view("apple")));
+    EXPECT_FALSE(copy.contains(std::string_view("apple")));
+    EXPECT_TRUE(copy.is_valid());
+
+    Words moved(std::move(copy));
+    EXPECT_EQ(moved.size(), 3u);
+    EXPECT_EQ(*moved.begin(), "fig");
+
+    tree = moved;
+    EXPECT_EQ(tree.size(), 3u);
+    EXPECT_TRUE(tree.is_valid());
+}
+
+TEST(RBPathTreeTest, IndexStorageMatchesStdSet) {
+    static_assert(sizeof(rb::IndexNode<int>) == 16);
+
+    rb::IndexTree<int> tree;
+    std::set<int> reference;
+    std::mt19937 rng{31337};
+    std::uniform_int_distribution<int> value_dist(0, 300);
+
+    for (int step = 0; step < 3000; ++step) {
+        const int value = value_dist(rng);
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(tree.erase(value), reference.erase(value) == 1);
+        } else {
+            ASSERT_EQ(tree.insert(value), reference.insert(value).second);
+        }
+    }
+    EXPECT_TRUE(tree.is_valid());
+    expect_same_contents(tree, reference);
+    // Освобождённые ячейки переиспользуются.
+    EXPECT_LE(tree.storage().capacity_used(), 301u);
+
+    rb::IndexTree<int> copy(tree);
+    copy.insert(1000);
+    EXPECT_FALSE(tree.contains(1000));
+    EXPECT_TRUE(copy.is_valid());
+}
+
+TEST(RBPathTreeTest, SoaStorageMatchesStdSet) {
+    rb::SoaTree<int> tree;
+    std::set<int> reference;
+    std::mt19937 rng{4242};
+    std::uniform_int_distribution<int> value_dist(0, 300);
+
+    for (int step = 0; step < 3000; ++step) {
+        const int value = value_dist(rng);
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(tree.erase(value), reference.erase(value) == 1);
+        } else {
+            ASSERT_EQ(tree.insert(value), reference.insert(value).second);
+        }
+    }
+    EXPECT_TRUE(tree.is_valid());
+    expect_same_contents(tree, reference);
+    EXPECT_EQ(tree.distance(50, 150),
+              static_cast<std::size_t>(std::distance(
+                  reference.lower_bound(50), reference.upper_bound(150))));
+
+    rb::SoaTree<std::string, rb::ThreeWayLess> words;
+    for (const char* word : {"kiwi", "lime", "date", "kiwi"}) {
+        words.insert(word);
+    }
+    words.erase(std::string_view("lime"));
+    words.insert("fig");
+    EXPECT_EQ(words.size(), 3u);
+    EXPECT_EQ(words.rank(std::string_view("kiwi")), 2u);
+    EXPECT_TRUE(words.is_valid());
+}
+
+TEST(RBPathTreeTest, IndexTreeRoundTripsThroughStream) {
+    rb::IndexTree<int> tree;
+    std::set<int> reference;
+    for (int value = 0; value < 500; value += 3) {
+        tree.insert(value);
+        reference.insert(value);
+    }
+    for (int value = 0; value < 500; value += 9) {
+        tree.erase(value);
+        reference.erase(value);
+    }
+
+    std::stringstream stream;
+    ASSERT_TRUE(rb::save(tree, stream));
+
+    rb::IndexTree<int> loaded;
+    ASSERT_TRUE(rb::load(stream, loaded));
+    EXPECT_TRUE(loaded.is_valid());
+    expect_same_contents(loaded, reference);
+    EXPECT_EQ(loaded.rank(250), tree.rank(250));
+
+    // Загруженное дерево продолжает переиспользовать свободные ячейки.
+    const std::size_t used = loaded.storage().capacity_used();
+    ASSERT_TRUE(loaded.insert(9));
+    EXPECT_EQ(loaded.storage().capacity_used(), used);
+}
+
+TEST(RBPathTreeTest, IndexTreeRejectsCorruptStream) {
+    rb::IndexTree<int> tree;
+    for (int value = 0; value < 64; ++value) {
+        tree.insert(value);
+    }
+    std::stringstream stream;
+    ASSERT_TRUE(rb::save(tree, stream));
+    std::string bytes = stream.str();
+
+    std::istringstream truncated(bytes.substr(0, bytes.size() - 5));
+    rb::IndexTree<int> target;
+    target.insert(7);
+    EXPECT_FALSE(rb::load(truncated, target));
+    EXPECT_EQ(target.size(), 1u);
+
+    // Меняем значение в одном из узлов: порядок ключей нарушается.
+    const std::size_t header = 3 * sizeof(std::uint64_t);
+    bytes[header + 5 * sizeof(rb::IndexNode<int>) + 12] = 100;
+    std::istringstream corrupted(bytes);
+    EXPECT_FALSE(rb::load(corrupted, target));
+    EXPECT_EQ(target.size(), 1u);
+}
+
+TEST(RBPathTreeTest, IndexTreeRejectsCraftedLinks) {
+    using Node = rb::IndexNode<int>;
+    constexpr std::uint32_t nil = rb::IndexStorage<int>::nil();
+    const auto serialize = [](std::uint64_t root, std::uint64_t free_head,
+                              const std::vector<Node>& nodes) {
+        const std::uint64_t header[3] = {nodes.size(), root, free_head};
+        std::string bytes(reinterpret_cast<const char*>(header), sizeof(header));
+        bytes.append(reinterpret_cast<const char*>(nodes.data()),
+                     nodes.size() * sizeof(Node));
+        return bytes;
+    };
+
+    // Длинная правая цепочка с согласованными размерами и чёрными узлами:
+    // проверка должна упереться в предел глубины, а не в стек.
+    const std::uint32_t chain = 200000;
+    std::vector<Node> nodes(chain);
+    for (std::uint32_t i = 0; i < chain; ++i) {
+        nodes[i] = Node{nil, i + 1 < chain ? i + 1 : nil, chain - i,
+                        static_cast<int>(i)};
+    }
+    rb::IndexTree<int> target;
+    target.insert(7);
+    std::istringstream chained(serialize(0, nil, nodes));
+    EXPECT_FALSE(rb::load(chained, target));
+    EXPECT_EQ(target.size(), 1u);
+
+    rb::IndexTree<int> tree;
+    for (int value = 0; value < 16; ++value) {
+        tree.insert(value);
+    }
+    tree.erase(3);
+    tree.erase(9);
+    std::stringstream stream;
+    ASSERT_TRUE(rb::save(tree, stream));
+    const std::string bytes = stream.str();
+    const std::size_t header = 3 * sizeof(std::uint64_t);
+    std::uint64_t fields[3];
+    std::memcpy(fields, bytes.data(), sizeof(fields));
+    const std::uint64_t free_head = fields[2];
+    ASSERT_NE(free_head, nil);
+
+    // Список свободных указывает на живой корень.
+    std::string aliased = bytes;
+    std::memcpy(&aliased[2 * sizeof(std::uint64_t)], &fields[1],
+                sizeof(std::uint64_t));
+    std::istringstream aliased_stream(aliased);
+    EXPECT_FALSE(rb::load(aliased_stream, target));
+
+    // Свободная ячейка ссылается сама на себя.
+    std::string cyclic = bytes;
+    const auto self = static_cast<std::uint32_t>(free_head);
+    std::memcpy(&cyclic[header + self * sizeof(Node)], &self, sizeof(self));
+    std::istringstream cyclic_stream(cyclic);
+    EXPECT_FALSE(rb::load(cyclic_stream, target));
+
+    // Ячейка не попала ни в дерево, ни в список свободных.
+    std::string leaked = bytes;
+    const std::uint64_t no_free = nil;
+    std::memcpy(&leaked[2 * sizeof(std::uint64_t)], &no_free, sizeof(no_free));
+    std::istringstream leaked_stream(leaked);
+    EXPECT_FALSE(rb::load(leaked_stream, target));
+    EXPECT_EQ(target.size(), 1u);
+}
@@ -0,0 +1,54 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "rb_range_counter.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(RBRangeCounterTest, MatchesBruteForce) {
+    std::mt19937 rng(17);
+    std::uniform_int_distribution<int> coordinate(-300, 300);
+    rb::RangeCounter2D<int> counter;
+    std::vector<std::pair<int, int>> points;
+
+    for (int i = 0; i < 2000; ++i) {
+        const int x = coordinate(rng);
+        const int y = coordinate(rng);
+        counter.insert(x, y);
+        points.emplace_back(x, y);
+
+        if (i % 10 == 0) {
+            const int x1 = coordinate(rng);
+            const int x2 = x1 + coordinate(rng) / 2;
+            const int y1 = coordinate(rng);
+            const int y2 = y1 + coordinate(rng) / 2;
+            std::size_t expected = 0;
+            for (const auto& [px, py] : points) {
+                expected += px >= x1 && px <= x2 && py >= y1 && py <= y2;
+            }
+            EXPECT_EQ(counter.count(x1, x2, y1, y2), expected);
+        }
+    }
+    EXPECT_EQ(counter.size(), points.size());
+    EXPECT_EQ(counter.count(-300, 300, -300, 300), points.size());
+    EXPECT_TRUE(counter.is_valid());
+}
+
+TEST(RBRangeCounterTest, BoundedRangeAndDuplicates) {
+    rb::RangeCounter2D<std::int32_t, double> counter(0, 99);
+    counter.insert(0, 1.5);
+    counter.insert(0, 1.5);
+    counter.insert(99, -2.0);
+    counter.insert(50, 0.0);
+
+    EXPECT_EQ(counter.count(0, 0, 1.5, 1.5), 2u);
+    EXPECT_EQ(counter.count(-1000, 1000, -10.0, 10.0), 4u);
+    EXPECT_EQ(counter.count(51, 1000, -2.0, -2.0), 1u);
+    EXPECT_EQ(counter.count(100, 200, -10.0, 10.0), 0u);
+    EXPECT_EQ(counter.count(-5, -1, -10.0, 10.0), 0u);
+    EXPECT_EQ(counter.count(10, 5, -10.0, 10.0), 0u);
+    EXPECT_EQ(counter.count(0, 99, 2.0, 1.0), 0u);
+}
@@ -0,0 +1,106 @@
+#include <atomic>
+#include <memory_resource>
+#include <thread>
+
+#include "rb_tree.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::atomic<int> destroyed{0};
+std::atomic<int> destroyed_elsewhere{0};
+std::thread::id test_thread;
+
+struct Tracked {
+    Tracked(int v = 0) : value(v) {}
+    Tracked(const Tracked&) = default;
+    Tracked(Tracked&&) = default;
+    Tracked& operator=(const Tracked&) = default;
+    Tracked& operator=(Tracked&&) = default;
+
+    ~Tracked() {
+        ++destroyed;
+        if (std::this_thread::get_id() != test_thread) {
+            ++destroyed_elsewhere;
+        }
+    }
+
+    bool operator<(const Tracked& other) const { return value < other.value; }
+
+    int value;
+};
+
+} // namespace
+
+TEST(RBReclaimerTest, DestroysNodesOnBackgroundThread) {
+    test_thread = std::this_thread::get_id();
+    rb::Reclaimer reclaimer;
+    {
+        rb::Tree<Tracked> tree;
+        tree.set_reclaimer(&reclaimer);
+        for (int i = 0; i < 1000; ++i) {
+            tree.insert(Tracked(i));
+        }
+        destroyed = 0;
+        destroyed_elsewhere = 0;
+
+        // Присваивание отдаёт старые узлы в фон и оставляет настройку.
+        rb::Tree<Tracked> replacement;
+        replacement.insert(Tracked(-1));
+        tree = std::move(replacement);
+        EXPECT_EQ(tree.size(), 1u);
+        EXPECT_EQ(tree.reclaimer(), &reclaimer);
+        reclaimer.drain();
+        EXPECT_EQ(destroyed_elsewhere.load(), 1000);
+
+        tree.clear();
+        EXPECT_TRUE(tree.empty());
+        EXPECT_TRUE(tree.is_valid());
+        tree.insert(Tracked(5));
+    }
+    reclaimer.drain();
+    EXPECT_EQ(destroyed_elsewhere.load(), 1002);
+    EXPECT_EQ(reclaimer.pending(), 0u);
+}
+
+TEST(RBReclaimerTest, WithoutReclaimerFreesInPlace) {
+    test_thread = std::this_thread::get_id();
+    rb::Tree<Tracked> tree;
+    for (int i = 0; i < 100; ++i) {
+        tree.insert(Tracked(i));
+    }
+    destroyed = 0;
+    destroyed_elsewhere = 0;
+    tree.clear();
+    EXPECT_EQ(destroyed.load(), 100);
+    EXPECT_EQ(destroyed_elsewhere.load(), 0);
+}
+
+TEST(RBReclaimerTest, ResourceBackedNodesAreFreedInPlace) {
+    test_thread = std::this_thread::get_id();
+    rb::Reclaimer reclaimer;
+    destroyed = 0;
+    destroyed_elsewhere = 0;
+    {
+        // Ресурс не синхронизирован и умирает раньше Reclaimer, поэтому
+        // дерево не должно отдавать его узлы фоновому потоку.
+        std::pmr::unsynchronized_pool_resource pool;
+        rb::Tree<Tracked> tree(&pool);
+        tree.set_reclaimer(&reclaimer);
+        for (int i = 0; i < 100; ++i) {
+            tree.insert(Tracked(i));
+        }
+        destroyed = 0;
+        tree.clear();
+        EXPECT_EQ(destroyed.load(), 100);
+        EXPECT_EQ(reclaimer.pending(), 0u);
+
+        tree.insert(Tracked(1));
+        tree.insert(Tracked(2));
+        destroyed = 0;
+    }
+    EXPECT_EQ(destroyed.load(), 2);
+    reclaimer.drain();
+    EXPECT_EQ(destroyed_elsewhere.load(), 0);
+}
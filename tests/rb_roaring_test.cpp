@@ -0,0 +1,109 @@
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+
+#include "rb_roaring.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+void expect_matches(const rb::RoaringSet& set,
+                    const std::set<std::uint32_t>& reference,
+                    std::mt19937& rng) {
+    ASSERT_EQ(set.size(), reference.size());
+    std::uniform_int_distribution<std::uint32_t> key_dist(0, 0x4FFFF);
+    for (int query = 0; query < 500; ++query) {
+        const std::uint32_t key = key_dist(rng);
+        ASSERT_EQ(set.contains(key), reference.count(key) == 1);
+        ASSERT_EQ(set.rank(key),
+                  static_cast<std::size_t>(std::distance(
+                      reference.begin(), reference.lower_bound(key))));
+
+        const auto lower = set.lower_bound(key);
+        const auto expected = reference.lower_bound(key);
+        ASSERT_EQ(lower.has_value(), expected != reference.end());
+        if (lower) {
+            ASSERT_EQ(*lower, *expected);
+        }
+
+        const std::uint32_t high = key + key_dist(rng) % 5000;
+        ASSERT_EQ(set.distance(key, high),
+                  static_cast<std::size_t>(std::distance(
+                      reference.lower_bound(key), reference.upper_bound(high))));
+    }
+}
+
+} // namespace
+
+TEST(RBRoaringTest, MixedContainersMatchStdSet) {
+    rb::RoaringSet set;
+    std::set<std::uint32_t> reference;
+    std::mt19937 rng{8080};
+
+    // Чанк 0 — разреженный, чанк 1 — плотный, чанк 3 — сплошные отрезки.
+    std::uniform_int_distribution<std::uint32_t> sparse(0, 0xFFFF);
+    for (int i = 0; i < 1000; ++i) {
+        const std::uint32_t key = sparse(rng);
+        ASSERT_EQ(set.insert(key), reference.insert(key).second);
+    }
+    for (std::uint32_t key = 0x10000; key < 0x20000; key += 2) {
+        set.insert(key);
+        reference.insert(key);
+    }
+    for (std::uint32_t key = 0x30000; key < 0x30000 + 20000; ++key) {
+        set.insert(key);
+        reference.insert(key);
+    }
+
+    using Kind = rb::RoaringSet::container_kind;
+    EXPECT_EQ(set.container_of(5), Kind::ARRAY);
+    EXPECT_EQ(set.container_of(0x10000), Kind::BITMAP);
+    expect_matches(set, reference, rng);
+
+    set.optimize();
+    EXPECT_EQ(set.container_of(0x30000), Kind::RUN);
+    expect_matches(set, reference, rng);
+
+    // Изменение отрезков разворачивает контейнер обратно.
+    std::uniform_int_distribution<std::uint32_t> any(0, 0x3FFFF);
+    for (int step = 0; step < 20000; ++step) {
+        const std::uint32_t key = any(rng);
+        if (step % 2 == 0) {
+            ASSERT_EQ(set.erase(key), reference.erase(key) == 1);
+        } else {
+            ASSERT_EQ(set.insert(key), reference.insert(key).second);
+        }
+    }
+    expect_matches(set, reference, rng);
+}
+
+TEST(RBRoaringTest, HandlesExtremeKeysAndEmptyChunks) {
+    rb::RoaringSet set;
+    EXPECT_FALSE(set.lower_bound(0).has_value());
+    EXPECT_EQ(set.distance(0, 0xFFFFFFFFu), 0u);
+
+    ASSERT_TRUE(set.insert(0xFFFFFFFFu));
+    ASSERT_TRUE(set.insert(7));
+    EXPECT_EQ(set.distance(0, 0xFFFFFFFFu), 2u);
+    EXPECT_EQ(*set.upper_bound(7), 0xFFFFFFFFu);
+    EXPECT_FALSE(set.upper_bound(0xFFFFFFFFu).has_value());
+
+    ASSERT_TRUE(set.erase(7));
+    EXPECT_FALSE(set.container_of(7).has_value());
+    EXPECT_EQ(set.rank(0xFFFFFFFFu), 0u);
+    EXPECT_EQ(*set.lower_bound(0), 0xFFFFFFFFu);
+}
+
+TEST(RBRoaringTest, DenseKeysUseFewBytesEach) {
+    rb::RoaringSet set;
+    std::mt19937 rng{11};
+    std::uniform_int_distribution<std::uint32_t> key_dist(0, 1000000);
+    for (int i = 0; i < 200000; ++i) {
+        set.insert(key_dist(rng));
+    }
+    set.optimize();
+    EXPECT_LT(set.memory_usage(), set.size() * 4);
+}
@@ -0,0 +1,166 @@
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "rb_map.hpp"
+#include "rb_tree.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Составной ключ, который нельзя неявно построить из int: если поиск по int
+// компилируется, временных объектов Employee гарантированно нет.
+struct Employee {
+    int id;
+    std::string name;
+};
+
+struct ById {
+    using is_transparent = void;
+
+    bool operator()(const Employee& lhs, const Employee& rhs) const {
+        return lhs.id < rhs.id;
+    }
+    bool operator()(const Employee& lhs, int rhs) const { return lhs.id < rhs; }
+    bool operator()(int lhs, const Employee& rhs) const { return lhs < rhs.id; }
+    bool operator()(int lhs, int rhs) const { return lhs < rhs; }
+};
+
+// Считает двусторонние и трёхсторонние сравнения отдельно.
+struct CountingThreeWay {
+    static int less_calls;
+    static int compare_calls;
+
+    bool operator()(int lhs, int rhs) const {
+        ++less_calls;
+        return lhs < rhs;
+    }
+
+    int compare(int lhs, int rhs) const {
+        ++compare_calls;
+        return (rhs < lhs) - (lhs < rhs);
+    }
+};
+
+int CountingThreeWay::less_calls = 0;
+int CountingThreeWay::compare_calls = 0;
+
+} // namespace
+
+TEST(RBTreeTransparentTest, CompositeKeyLookupByMember) {
+    rb::Tree<Employee, rb::NoAugment, rb::IdentityKey, ById> tree;
+    for (int id = 0; id < 50; id += 2) {
+        ASSERT_TRUE(tree.insert(Employee{id, "e" + std::to_string(id)}));
+    }
+
+    ASSERT_NE(tree.find(10), tree.end());
+    EXPECT_EQ(tree.find(10)->name, "e10");
+    EXPECT_EQ(tree.find(11), tree.end());
+    EXPECT_TRUE(tree.contains(48));
+    EXPECT_EQ(tree.lower_bound(11)->id, 12);
+    EXPECT_EQ(tree.upper_bound(12)->id, 14);
+    EXPECT_EQ(tree.rank(11), 6u);
+    EXPECT_EQ(tree.distance(5, 15), 5u);
+    EXPECT_EQ(tree.distance_from_root(20), 10u);
+    EXPECT_TRUE(tree.erase(20));
+    EXPECT_FALSE(tree.erase(21));
+    EXPECT_TRUE(tree.is_valid());
+}
+
+TEST(RBTreeTransparentTest, StringKeysAcceptStringView) {
+    rb::Tree<std::string, rb::NoAugment, rb::IdentityKey, rb::ThreeWayLess> tree;
+    for (const char* word : {"delta", "alpha", "echo", "bravo", "charlie"}) {
+        tree.insert(word);
+    }
+
+    constexpr std::string_view probe = "bz";
+    EXPECT_EQ(*tree.lower_bound(probe), "charlie");
+    EXPECT_EQ(tree.rank(probe), 2u);
+    EXPECT_EQ(tree.distance(std::string_view("b"), std::string_view("d")), 2u);
+    EXPECT_TRUE(tree.contains(std::string_view("echo")));
+
+    rb::Map<std::string, int, rb::ThreeWayLess> map;
+    map["alpha"] = 1;
+    map["bravo"] = 2;
+    int* value = map.find(std::string_view("bravo"));
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, 2);
+    EXPECT_EQ(map.rank(std::string_view("b")), 1u);
+}
+
+TEST(RBTreeTransparentTest, DefaultComparatorConvertsLookupKeys) {
+    // Без прозрачного компаратора аргумент приводится к key_type.
+    rb::Tree<int> numbers;
+    numbers.insert(-1);
+    numbers.insert(5);
+    EXPECT_EQ(numbers.rank(0u), 1u);
+    EXPECT_TRUE(numbers.contains(5.5));
+    EXPECT_EQ(*numbers.lower_bound(2.5), 5);
+
+    rb::Tree<std::string> words;
+    words.insert("ab");
+    words.insert("abc");
+    EXPECT_EQ(words.distance("a", "abc"), 2u);
+    EXPECT_TRUE(words.contains({'a', 'b'}));
+
+    rb::Map<std::string, int> map;
+    map["ab"] = 1;
+    EXPECT_EQ(map.rank("b"), 1u);
+    EXPECT_NE(map.find("ab"), nullptr);
+}
+
+TEST(RBTreeThreeWayTest, ExactDescentUsesOneComparisonPerLevel) {
+    rb::Tree<int, rb::NoAugment, rb::IdentityKey, CountingThreeWay> tree;
+    constexpr int kCount = 1024;
+    for (int i = 0; i < kCount; ++i) {
+        ASSERT_TRUE(tree.insert(i));
+    }
+    ASSERT_TRUE(tree.is_valid());
+
+    CountingThreeWay::less_calls = 0;
+    CountingThreeWay::compare_calls = 0;
+    for (int i = 0; i < kCount; ++i) {
+        ASSERT_TRUE(tree.contains(i));
+    }
+    EXPECT_FALSE(tree.contains(kCount));
+    EXPECT_EQ(CountingThreeWay::less_calls, 0);
+
+    const int max_height = 2 * static_cast<int>(std::log2(kCount + 1)) + 1;
+    EXPECT_LE(CountingThreeWay::compare_calls, (kCount + 1) * max_height);
+
+    CountingThreeWay::less_calls = 0;
+    EXPECT_TRUE(tree.erase(kCount / 2));
+    EXPECT_EQ(tree.distance_from_root(kCount / 2 + 1),
+              static_cast<std::size_t>(kCount / 2));
+    EXPECT_EQ(CountingThreeWay::less_calls, 0);
+}
+
+TEST(RBTreeThreeWayTest, DefaultComparatorOrdersStrings) {
+    rb::ThreeWayLess compare;
+    EXPECT_LT(compare.compare(std::string("abc"), std::string_view("abd")), 0);
+    EXPECT_GT(compare.compare(std::string_view("b"), std::string("abc")), 0);
+    EXPECT_EQ(compare.compare(std::string("same"), std::string("same")), 0);
+    EXPECT_EQ(compare.compare(3, 3L), 0);
+    EXPECT_LT(compare.compare(-1, 2.5), 0);
+}
+
+TEST(RBTreeThreeWayTest, MixedSignProbesCompareByValue) {
+    rb::ThreeWayLess compare;
+    EXPECT_LT(compare.compare(-1, 0u), 0);
+    EXPECT_GT(compare.compare(0u, -1), 0);
+    EXPECT_GT(compare.compare(~0ull, -1LL), 0);
+    EXPECT_EQ(compare.compare(7u, 7), 0);
+    EXPECT_TRUE(compare(-1, 0u));
+    EXPECT_FALSE(compare(0u, -1));
+
+    rb::Tree<int, rb::NoAugment, rb::IdentityKey, rb::ThreeWayLess> tree;
+    for (int value : {-3, -1, 5}) {
+        tree.insert(value);
+    }
+    EXPECT_EQ(tree.rank(0u), 2u);
+    EXPECT_EQ(*tree.lower_bound(0u), 5);
+    EXPECT_TRUE(tree.contains(5u));
+    EXPECT_EQ(tree.distance(0u, 4294967295u), 1u);
+}
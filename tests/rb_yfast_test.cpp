@@ -0,0 +1,82 @@
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+
+#include "rb_yfast.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+void expect_matches(const rb::YFastSet& set,
+                    const std::set<std::uint64_t>& reference,
+                    std::uint64_t query) {
+    ASSERT_EQ(set.contains(query), reference.count(query) == 1);
+    ASSERT_EQ(set.rank(query),
+              static_cast<std::size_t>(std::distance(
+                  reference.begin(), reference.lower_bound(query))));
+    const auto lower = set.lower_bound(query);
+    const auto expected = reference.lower_bound(query);
+    ASSERT_EQ(lower.has_value(), expected != reference.end());
+    if (lower) {
+        ASSERT_EQ(*lower, *expected);
+    }
+}
+
+} // namespace
+
+TEST(RBYFastTest, RandomUpdatesMatchStdSet) {
+    rb::YFastSet set;
+    std::set<std::uint64_t> reference;
+    std::mt19937_64 rng{1234};
+    // Узкий диапазон даёт много дубликатов и удалений существующих ключей,
+    // широкий — проверяет старшие биты.
+    std::uniform_int_distribution<std::uint64_t> narrow(0, 20000);
+
+    for (int step = 0; step < 30000; ++step) {
+        const std::uint64_t key = step % 5 == 0 ? rng() : narrow(rng);
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(set.erase(key), reference.erase(key) == 1);
+        } else {
+            ASSERT_EQ(set.insert(key), reference.insert(key).second);
+        }
+        if (step % 100 == 0) {
+            expect_matches(set, reference, narrow(rng));
+            expect_matches(set, reference, rng());
+        }
+    }
+    ASSERT_EQ(set.size(), reference.size());
+
+    for (int query = 0; query < 300; ++query) {
+        const std::uint64_t first = narrow(rng);
+        const std::uint64_t second = first + narrow(rng);
+        ASSERT_EQ(set.distance(first, second),
+                  static_cast<std::size_t>(
+                      std::distance(reference.lower_bound(first),
+                                    reference.upper_bound(second))));
+    }
+
+    // Удаляем всё, чтобы пройти слияния корзин до пустого множества.
+    for (std::uint64_t key : reference) {
+        ASSERT_TRUE(set.erase(key));
+    }
+    EXPECT_TRUE(set.empty());
+    EXPECT_FALSE(set.lower_bound(0).has_value());
+}
+
+TEST(RBYFastTest, HandlesExtremeKeys) {
+    rb::YFastSet set;
+    const std::uint64_t max = ~std::uint64_t{0};
+    ASSERT_TRUE(set.insert(max));
+    ASSERT_TRUE(set.insert(0));
+    ASSERT_TRUE(set.insert(max / 2));
+
+    EXPECT_EQ(set.distance(0, max), 3u);
+    EXPECT_EQ(set.distance(1, max - 1), 1u);
+    EXPECT_EQ(set.rank(max), 2u);
+    EXPECT_EQ(*set.lower_bound(max / 2 + 1), max);
+    EXPECT_TRUE(set.erase(0));
+    EXPECT_EQ(*set.lower_bound(0), max / 2);
+}